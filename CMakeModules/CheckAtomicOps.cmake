@@ -25,6 +25,33 @@ int main()
 }
 " _OPENTHREADS_ATOMIC_USE_GCC_BUILTINS)
 
+# The __atomic builtins take an explicit memory order, they are used on top
+# of the __sync ones wherever the compiler has them.
+CHECK_CXX_SOURCE_RUNS("
+#include <cstdlib>
+
+int main()
+{
+   unsigned value = 0;
+   long long wide = 0;
+   void* ptr = &value;
+   __atomic_fetch_add(&value, 1, __ATOMIC_ACQ_REL);
+   __atomic_fetch_add(&wide, 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   if (__atomic_load_n(&value, __ATOMIC_ACQUIRE) != 1 || __atomic_load_n(&wide, __ATOMIC_RELAXED) != 1)
+      return EXIT_FAILURE;
+
+   unsigned expected = 1;
+   if (!__atomic_compare_exchange_n(&value, &expected, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      return EXIT_FAILURE;
+
+   if (__atomic_exchange_n(&ptr, ptr, __ATOMIC_RELEASE) != &value)
+      return EXIT_FAILURE;
+
+   return EXIT_SUCCESS;
+}
+" _OPENTHREADS_ATOMIC_USE_GCC_ATOMIC_BUILTINS)
+
 CHECK_CXX_SOURCE_RUNS("
 #include <stdlib.h>
 
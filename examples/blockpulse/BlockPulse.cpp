@@ -0,0 +1,109 @@
+//
+// OpenThread library, Copyright (C) 2002 - 2015  The Open Thread Group
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+//
+// Pulse a Block and a BlockCount, release() immediately followed by reset(),
+// and check that the thread waiting at the time of the release gets through.
+// Exits with 1 if a waiter is still blocked after a few seconds.
+//
+
+#include <OpenThreads/Block.h>
+#include <OpenThreads/Thread.h>
+#include <iostream>
+
+class BlockWaiter : public OpenThreads::Thread
+{
+public:
+
+    BlockWaiter(OpenThreads::Block& block) : _block(block) {}
+
+    virtual void run() { _block.block(); }
+
+private:
+
+    OpenThreads::Block& _block;
+};
+
+class BlockCountWaiter : public OpenThreads::Thread
+{
+public:
+
+    BlockCountWaiter(OpenThreads::BlockCount& blockCount) : _blockCount(blockCount) {}
+
+    virtual void run() { _blockCount.block(); }
+
+private:
+
+    OpenThreads::BlockCount& _blockCount;
+};
+
+// wait up to five seconds for thread to finish
+static bool finished(OpenThreads::Thread& thread)
+{
+    for(int i=0; i<500 && thread.isRunning(); ++i) OpenThreads::Thread::microSleep(10000);
+    return !thread.isRunning();
+}
+
+int main(int, char**)
+{
+    const int numPulses = 20;
+    int failures = 0;
+
+    for(int i=0; i<numPulses; ++i)
+    {
+        OpenThreads::Block block;
+        BlockWaiter waiter(block);
+        waiter.start();
+
+        // give the waiter time to go to sleep in block()
+        OpenThreads::Thread::microSleep(2000);
+        block.release();
+        block.reset();
+
+        if (!finished(waiter))
+        {
+            std::cout << "Block pulse " << i << ": waiter still blocked" << std::endl;
+            ++failures;
+            block.release();
+        }
+        waiter.join();
+    }
+
+    for(int i=0; i<numPulses; ++i)
+    {
+        OpenThreads::BlockCount blockCount(1);
+        blockCount.reset();
+        BlockCountWaiter waiter(blockCount);
+        waiter.start();
+
+        OpenThreads::Thread::microSleep(2000);
+        blockCount.completed();
+        blockCount.reset();
+
+        if (!finished(waiter))
+        {
+            std::cout << "BlockCount pulse " << i << ": waiter still blocked" << std::endl;
+            ++failures;
+            blockCount.release();
+        }
+        waiter.join();
+    }
+
+    std::cout << (failures ? "FAILED" : "passed") << ", " << failures << " of " << 2*numPulses << " pulses lost" << std::endl;
+    return failures ? 1 : 0;
+}
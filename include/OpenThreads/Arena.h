@@ -0,0 +1,286 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// Arena - bump allocation of scratch memory, released in bulk
+// ~~~~~
+//
+
+#ifndef _OPENTHREADS_ARENA_
+#define _OPENTHREADS_ARENA_
+
+#include <OpenThreads/Exports.h>
+#include <stddef.h>
+#include <new>
+#include <utility>
+
+namespace OpenThreads {
+
+/**
+ *  @class Arena
+ *  @brief  Allocator of short-lived memory that hands out consecutive pieces of large blocks, and takes them all back
+ *          at once.
+ *
+ *  allocate() only moves a pointer forward, there is no per-allocation deallocation.  reset() makes all the memory
+ *  available again in constant time, keeping the blocks for the next round, so that a task or a frame that always
+ *  needs about the same amount of scratch memory stops calling malloc() after the first round.  getMarker() and
+ *  rewind() take back only the memory allocated since the marker, for nested scopes.
+ *
+ *  Destructors of objects placed in the arena are never run, it is meant for buffers and trivially destructible
+ *  types.  An Arena is not thread safe, ThreadLocalArena gives each thread its own.
+ */
+class OPENTHREAD_EXPORT_DIRECTIVE Arena
+{
+public:
+
+    enum
+    {
+        /** Default size of the blocks the arena carves allocations from.*/
+        DEFAULT_BLOCK_SIZE = 64 * 1024,
+
+        /** Alignment of allocate() unless asked otherwise, enough for any fundamental type.*/
+        DEFAULT_ALIGNMENT = 16
+    };
+
+    /** Position in the arena, returned by getMarker() and taken by rewind().*/
+    struct Marker
+    {
+        void*   block;
+        char*   position;
+    };
+
+    /**
+     *  Create an empty arena, which allocates its first block on the first allocate().  Allocations larger than
+     *  blockSize get a block of their own.
+     */
+    explicit Arena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+    /**
+     *  Give all the blocks back.  Pointers into the arena become invalid.
+     */
+    ~Arena();
+
+    /**
+     *  Allocate size bytes aligned to alignment, a power of two.
+     */
+    void* allocate(size_t size, size_t alignment = DEFAULT_ALIGNMENT)
+    {
+        char* position = alignUp(_position, alignment);
+        if (position>=_position && position<=_end && size<=static_cast<size_t>(_end - position))
+        {
+            _position = position + size;
+            return position;
+        }
+        return allocateSlow(size, alignment);
+    }
+
+    /**
+     *  Allocate uninitialised storage for count objects of type T.
+     */
+    template<typename T>
+    T* allocateArray(size_t count)
+    {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    /**
+     *  Construct an object in the arena, with args passed on to the constructor of T.  Its destructor is never run.
+     */
+    template<typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    /**
+     *  Return the current position, to rewind() to later.
+     */
+    Marker getMarker() const
+    {
+        Marker marker = { _current, _position };
+        return marker;
+    }
+
+    /**
+     *  Take back everything allocated since marker was taken.  Blocks are kept.
+     */
+    void rewind(const Marker& marker);
+
+    /**
+     *  Take back everything allocated, in constant time.  Blocks are kept for reuse.
+     */
+    void reset();
+
+    /**
+     *  Take back everything allocated and give the blocks back, except the first one.
+     */
+    void trim();
+
+    /** Return the number of bytes of the blocks the arena holds.*/
+    size_t getCapacity() const { return _capacity; }
+
+private:
+
+    struct Block;
+
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
+    static char* alignUp(char* position, size_t alignment)
+    {
+        return reinterpret_cast<char*>((reinterpret_cast<size_t>(position) + alignment - 1) & ~(alignment - 1));
+    }
+
+    void* allocateSlow(size_t size, size_t alignment);
+
+    void setCurrent(Block* block);
+
+    const size_t    _blockSize;
+    Block*          _first;
+    Block*          _current;
+    char*           _position;
+    char*           _end;
+    size_t          _capacity;
+};
+
+/**
+ *  @class ArenaScope
+ *  @brief  Rewind an arena to where it was on construction when the scope ends.
+ *
+ *  @code
+ *  void MyTask::run()
+ *  {
+ *      ArenaScope scope(ThreadLocalArena::get());
+ *      float* samples = scope.getArena().allocateArray<float>(numSamples);
+ *      ...
+ *  }
+ *  @endcode
+ */
+class ArenaScope
+{
+public:
+
+    explicit ArenaScope(Arena& arena) :
+        _arena(arena),
+        _marker(arena.getMarker()) {}
+
+    ~ArenaScope() { _arena.rewind(_marker); }
+
+    Arena& getArena() { return _arena; }
+
+private:
+
+    ArenaScope(const ArenaScope&);
+    ArenaScope& operator=(const ArenaScope&);
+
+    Arena&          _arena;
+    Arena::Marker   _marker;
+};
+
+/**
+ *  @class ThreadLocalArena
+ *  @brief  One Arena per thread, for scratch memory that never leaves the thread.
+ *
+ *  A thread's arena is created by its first get() and destroyed when the thread exits: by OpenThreads::Thread when
+ *  run() returns or the thread is cancelled, at thread exit for other threads.  Tasks of a ThreadPool bracket their
+ *  use with an ArenaScope, or reset() at the end of run(), so that each task starts from an empty arena.
+ */
+class OPENTHREAD_EXPORT_DIRECTIVE ThreadLocalArena
+{
+public:
+
+    /**
+     *  Return the arena of the calling thread.
+     */
+    static Arena& get();
+
+    /**
+     *  Reset the arena of the calling thread, if it has one.
+     */
+    static void reset();
+
+    /**
+     *  Destroy the arena of the calling thread, if it has one.  A later get() creates a new one.
+     */
+    static void release();
+
+private:
+
+    ThreadLocalArena();
+};
+
+/**
+ *  @class ArenaAllocator
+ *  @brief  Standard library allocator on an Arena, for containers of scratch data.
+ *
+ *  @code
+ *  std::vector<int, ArenaAllocator<int> > indices(ArenaAllocator<int>(ThreadLocalArena::get()));
+ *  @endcode
+ *
+ *  deallocate() does nothing, the memory comes back when the arena is reset or rewound.  The container must be
+ *  destroyed, or at least not used, before that.
+ */
+template<typename T>
+class ArenaAllocator
+{
+public:
+
+    typedef T               value_type;
+    typedef T*              pointer;
+    typedef const T*        const_pointer;
+    typedef T&              reference;
+    typedef const T&        const_reference;
+    typedef size_t          size_type;
+    typedef ptrdiff_t       difference_type;
+
+    template<typename U>
+    struct rebind { typedef ArenaAllocator<U> other; };
+
+    explicit ArenaAllocator(Arena& arena) : _arena(&arena) {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& rhs) : _arena(rhs.getArena()) {}
+
+    T* allocate(size_t count, const void* = 0)
+    {
+        if (count>max_size()) throw std::bad_alloc();
+        return _arena->allocateArray<T>(count);
+    }
+
+    void deallocate(T*, size_t) {}
+
+    size_t max_size() const { return static_cast<size_t>(-1) / sizeof(T); }
+
+    template<typename U, typename... Args>
+    void construct(U* object, Args&&... args) { new (object) U(std::forward<Args>(args)...); }
+
+    template<typename U>
+    void destroy(U* object) { object->~U(); }
+
+    Arena* getArena() const { return _arena; }
+
+private:
+
+    Arena*  _arena;
+};
+
+template<typename T, typename U>
+inline bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) { return lhs.getArena()==rhs.getArena(); }
+
+template<typename T, typename U>
+inline bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) { return lhs.getArena()!=rhs.getArena(); }
+
+}
+
+#endif // _OPENTHREADS_ARENA_
@@ -220,7 +220,9 @@ Atomic::exchange(unsigned value)
 _OPENTHREADS_ATOMIC_INLINE
 Atomic::operator unsigned() const
 {
-#if defined(_OPENTHREADS_ATOMIC_USE_GCC_BUILTINS)
+#if defined(_OPENTHREADS_ATOMIC_USE_GCC_ATOMIC_BUILTINS)
+    return __atomic_load_n(&_value, __ATOMIC_ACQUIRE);
+#elif defined(_OPENTHREADS_ATOMIC_USE_GCC_BUILTINS)
     __sync_synchronize();
     return _value;
 #elif defined(_OPENTHREADS_ATOMIC_USE_MIPOSPRO_BUILTINS)
@@ -263,7 +265,9 @@ AtomicPtr::assign(void* ptrNew, const void* const ptrOld)
 _OPENTHREADS_ATOMIC_INLINE void*
 AtomicPtr::get() const
 {
-#if defined(_OPENTHREADS_ATOMIC_USE_GCC_BUILTINS)
+#if defined(_OPENTHREADS_ATOMIC_USE_GCC_ATOMIC_BUILTINS)
+    return __atomic_load_n(&_ptr, __ATOMIC_ACQUIRE);
+#elif defined(_OPENTHREADS_ATOMIC_USE_GCC_BUILTINS)
     __sync_synchronize();
     return _ptr;
 #elif defined(_OPENTHREADS_ATOMIC_USE_MIPOSPRO_BUILTINS)
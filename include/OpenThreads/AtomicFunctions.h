@@ -4,6 +4,19 @@
 #include <OpenThreads/Exports.h>
 #include <stdint.h>
 
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#endif
+
+// With the __atomic builtins the functions are defined inline below, so that
+// each variant compiles to the instructions its memory order needs.
+// Otherwise they are implemented in the library.
+#if defined(_OPENTHREADS_ATOMIC_USE_GCC_ATOMIC_BUILTINS)
+    #define OPENTHREAD_ATOMIC_FUNCTION inline
+#else
+    #define OPENTHREAD_ATOMIC_FUNCTION OPENTHREAD_EXPORT_DIRECTIVE
+#endif
+
 namespace OpenThreads
 {
     /// Atomically swap the current value of a 32-bit integer with another value, with full memory barriers.
@@ -12,7 +25,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to swap.
 	///
 	/// @return  Original integer value upon swapping.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicExchange( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicExchange( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically swap the current value of a 32-bit integer with another value, with acquire semantics.
 	///
@@ -20,7 +33,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to swap.
 	///
 	/// @return  Original integer value upon swapping.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicExchangeAcquire( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicExchangeAcquire( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically swap the current value of a 32-bit integer with another value, with release semantics.
 	///
@@ -28,7 +41,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to swap.
 	///
 	/// @return  Original integer value upon swapping.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicExchangeRelease( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicExchangeRelease( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically swap the current value of a 32-bit integer with another value, without any memory barriers.
 	///
@@ -36,7 +49,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to swap.
 	///
 	/// @return  Original integer value upon swapping.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicExchangeUnsafe( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicExchangeUnsafe( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically compare the current value of a 32-bit integer with another value, swapping in a different value if
 	/// the values match, with full memory barriers.
@@ -47,7 +60,7 @@ namespace OpenThreads
 	///
 	/// @return  Original integer value when the comparison occurred.  If this is the same as @c compare, the integer's
 	///          value will have been updated to match @c value, otherwise it will have been left unchanged.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicCompareExchange( int32_t volatile & rAtomic, int32_t value, int32_t compare );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicCompareExchange( int32_t volatile & rAtomic, int32_t value, int32_t compare );
 
 	/// Atomically compare the current value of a 32-bit integer with another value, swapping in a different value if
 	/// the values match, with acquire semantics.
@@ -58,7 +71,7 @@ namespace OpenThreads
 	///
 	/// @return  Original integer value when the comparison occurred.  If this is the same as @c compare, the integer's
 	///          value will have been updated to match @c value, otherwise it will have been left unchanged.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicCompareExchangeAcquire( int32_t volatile & rAtomic, int32_t value, int32_t compare );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicCompareExchangeAcquire( int32_t volatile & rAtomic, int32_t value, int32_t compare );
 
 	/// Atomically compare the current value of a 32-bit integer with another value, swapping in a different value if
 	/// the values match, with release semantics.
@@ -69,7 +82,7 @@ namespace OpenThreads
 	///
 	/// @return  Original integer value when the comparison occurred.  If this is the same as @c compare, the integer's
 	///          value will have been updated to match @c value, otherwise it will have been left unchanged.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicCompareExchangeRelease( int32_t volatile & rAtomic, int32_t value, int32_t compare );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicCompareExchangeRelease( int32_t volatile & rAtomic, int32_t value, int32_t compare );
 
 	/// Atomically compare the current value of a 32-bit integer with another value, swapping in a different value if
 	/// the values match, without any memory barriers.
@@ -80,63 +93,63 @@ namespace OpenThreads
 	///
 	/// @return  Original integer value when the comparison occurred.  If this is the same as @c compare, the integer's
 	///          value will have been updated to match @c value, otherwise it will have been left unchanged.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicCompareExchangeUnsafe( int32_t volatile & rAtomic, int32_t value, int32_t compare );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicCompareExchangeUnsafe( int32_t volatile & rAtomic, int32_t value, int32_t compare );
 
 	/// Atomically increment a 32-bit integer, with full memory barriers.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after incrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicIncrement( int32_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicIncrement( int32_t volatile & rAtomic );
 
 	/// Atomically increment a 32-bit integer, with acquire semantics.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after incrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicIncrementAcquire( int32_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicIncrementAcquire( int32_t volatile & rAtomic );
 
 	/// Atomically increment a 32-bit integer, with release semantics.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after incrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicIncrementRelease( int32_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicIncrementRelease( int32_t volatile & rAtomic );
 
 	/// Atomically increment a 32-bit integer, without any memory barriers.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after incrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicIncrementUnsafe( int32_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicIncrementUnsafe( int32_t volatile & rAtomic );
 
 	/// Atomically decrement a 32-bit integer, with full memory barriers.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after decrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicDecrement( int32_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicDecrement( int32_t volatile & rAtomic );
 
 	/// Atomically decrement a 32-bit integer, with acquire semantics.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after decrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicDecrementAcquire( int32_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicDecrementAcquire( int32_t volatile & rAtomic );
 
 	/// Atomically decrement a 32-bit integer, with release semantics.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after decrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicDecrementRelease( int32_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicDecrementRelease( int32_t volatile & rAtomic );
 
 	/// Atomically decrement a 32-bit integer, without any memory barriers.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after decrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicDecrementUnsafe( int32_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicDecrementUnsafe( int32_t volatile & rAtomic );
 
 	/// Atomically add a value to a 32-bit integer, with full memory barriers.
 	///
@@ -144,7 +157,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to add.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicAdd( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicAdd( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically add a value to a 32-bit integer, with acquire semantics.
 	///
@@ -152,7 +165,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to add.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicAddAcquire( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicAddAcquire( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically add a value to a 32-bit integer, with release semantics.
 	///
@@ -160,7 +173,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to add.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicAddRelease( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicAddRelease( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically add a value to a 32-bit integer, without any memory barriers.
 	///
@@ -168,7 +181,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to add.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicAddUnsafe( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicAddUnsafe( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically subtract a value from a 32-bit integer, with full memory barriers.
 	///
@@ -176,7 +189,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to subtract.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicSubtract( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicSubtract( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically subtract a value from a 32-bit integer, with acquire semantics.
 	///
@@ -184,7 +197,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to subtract.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicSubtractAcquire( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicSubtractAcquire( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically subtract a value from a 32-bit integer, with release semantics.
 	///
@@ -192,7 +205,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to subtract.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicSubtractRelease( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicSubtractRelease( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically subtract a value from a 32-bit integer, without any memory barriers.
 	///
@@ -200,7 +213,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to subtract.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicSubtractUnsafe( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicSubtractUnsafe( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically AND a 32-bit integer with another value, with full memory barriers.
 	///
@@ -208,7 +221,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to AND.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicAnd( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicAnd( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically AND a 32-bit integer with another value, with acquire semantics.
 	///
@@ -216,7 +229,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to AND.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicAndAcquire( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicAndAcquire( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically AND a 32-bit integer with another value, with release semantics.
 	///
@@ -224,7 +237,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to AND.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicAndRelease( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicAndRelease( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically AND a 32-bit integer with another value, without any memory barriers.
 	///
@@ -232,7 +245,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to AND.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicAndUnsafe( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicAndUnsafe( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically OR a 32-bit integer with another value, with full memory barriers.
 	///
@@ -240,7 +253,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to OR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicOr( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicOr( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically OR a 32-bit integer with another value, with acquire semantics.
 	///
@@ -248,7 +261,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to OR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicOrAcquire( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicOrAcquire( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically OR a 32-bit integer with another value, with release semantics.
 	///
@@ -256,7 +269,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to OR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicOrRelease( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicOrRelease( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically OR a 32-bit integer with another value, without any memory barriers.
 	///
@@ -264,7 +277,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to OR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicOrUnsafe( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicOrUnsafe( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically XOR a 32-bit integer with another value, with full memory barriers.
 	///
@@ -272,7 +285,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to XOR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicXor( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicXor( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically XOR a 32-bit integer with another value, with acquire semantics.
 	///
@@ -280,7 +293,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to XOR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicXorAcquire( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicXorAcquire( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically XOR a 32-bit integer with another value, with release semantics.
 	///
@@ -288,7 +301,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to XOR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicXorRelease( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicXorRelease( int32_t volatile & rAtomic, int32_t value );
 
 	/// Atomically XOR a 32-bit integer with another value, without any memory barriers.
 	///
@@ -296,7 +309,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to XOR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int32_t AtomicXorUnsafe( int32_t volatile & rAtomic, int32_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int32_t AtomicXorUnsafe( int32_t volatile & rAtomic, int32_t value );
 
 	// ---- 64-bit integer variant
 		/// Atomically swap the current value of a 64-bit integer with another value, with full memory barriers.
@@ -305,7 +318,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to swap.
 	///
 	/// @return  Original integer value upon swapping.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicExchange( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicExchange( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically swap the current value of a 64-bit integer with another value, with acquire semantics.
 	///
@@ -313,7 +326,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to swap.
 	///
 	/// @return  Original integer value upon swapping.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicExchangeAcquire( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicExchangeAcquire( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically swap the current value of a 64-bit integer with another value, with release semantics.
 	///
@@ -321,7 +334,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to swap.
 	///
 	/// @return  Original integer value upon swapping.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicExchangeRelease( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicExchangeRelease( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically swap the current value of a 64-bit integer with another value, without any memory barriers.
 	///
@@ -329,7 +342,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to swap.
 	///
 	/// @return  Original integer value upon swapping.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicExchangeUnsafe( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicExchangeUnsafe( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically compare the current value of a 64-bit integer with another value, swapping in a different value if
 	/// the values match, with full memory barriers.
@@ -340,7 +353,7 @@ namespace OpenThreads
 	///
 	/// @return  Original integer value when the comparison occurred.  If this is the same as @c compare, the integer's
 	///          value will have been updated to match @c value, otherwise it will have been left unchanged.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicCompareExchange( int64_t volatile & rAtomic, int64_t value, int64_t compare );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicCompareExchange( int64_t volatile & rAtomic, int64_t value, int64_t compare );
 
 	/// Atomically compare the current value of a 64-bit integer with another value, swapping in a different value if
 	/// the values match, with acquire semantics.
@@ -351,7 +364,7 @@ namespace OpenThreads
 	///
 	/// @return  Original integer value when the comparison occurred.  If this is the same as @c compare, the integer's
 	///          value will have been updated to match @c value, otherwise it will have been left unchanged.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicCompareExchangeAcquire( int64_t volatile & rAtomic, int64_t value, int64_t compare );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicCompareExchangeAcquire( int64_t volatile & rAtomic, int64_t value, int64_t compare );
 
 	/// Atomically compare the current value of a 64-bit integer with another value, swapping in a different value if
 	/// the values match, with release semantics.
@@ -362,7 +375,7 @@ namespace OpenThreads
 	///
 	/// @return  Original integer value when the comparison occurred.  If this is the same as @c compare, the integer's
 	///          value will have been updated to match @c value, otherwise it will have been left unchanged.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicCompareExchangeRelease( int64_t volatile & rAtomic, int64_t value, int64_t compare );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicCompareExchangeRelease( int64_t volatile & rAtomic, int64_t value, int64_t compare );
 
 	/// Atomically compare the current value of a 64-bit integer with another value, swapping in a different value if
 	/// the values match, without any memory barriers.
@@ -373,63 +386,63 @@ namespace OpenThreads
 	///
 	/// @return  Original integer value when the comparison occurred.  If this is the same as @c compare, the integer's
 	///          value will have been updated to match @c value, otherwise it will have been left unchanged.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicCompareExchangeUnsafe( int64_t volatile & rAtomic, int64_t value, int64_t compare );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicCompareExchangeUnsafe( int64_t volatile & rAtomic, int64_t value, int64_t compare );
 
 	/// Atomically increment a 64-bit integer, with full memory barriers.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after incrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicIncrement( int64_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicIncrement( int64_t volatile & rAtomic );
 
 	/// Atomically increment a 64-bit integer, with acquire semantics.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after incrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicIncrementAcquire( int64_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicIncrementAcquire( int64_t volatile & rAtomic );
 
 	/// Atomically increment a 64-bit integer, with release semantics.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after incrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicIncrementRelease( int64_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicIncrementRelease( int64_t volatile & rAtomic );
 
 	/// Atomically increment a 64-bit integer, without any memory barriers.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after incrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicIncrementUnsafe( int64_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicIncrementUnsafe( int64_t volatile & rAtomic );
 
 	/// Atomically decrement a 64-bit integer, with full memory barriers.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after decrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicDecrement( int64_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicDecrement( int64_t volatile & rAtomic );
 
 	/// Atomically decrement a 64-bit integer, with acquire semantics.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after decrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicDecrementAcquire( int64_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicDecrementAcquire( int64_t volatile & rAtomic );
 
 	/// Atomically decrement a 64-bit integer, with release semantics.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after decrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicDecrementRelease( int64_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicDecrementRelease( int64_t volatile & rAtomic );
 
 	/// Atomically decrement a 64-bit integer, without any memory barriers.
 	///
 	/// @param[in] rAtomic  Integer to update.
 	///
 	/// @return  New value after decrementing.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicDecrementUnsafe( int64_t volatile & rAtomic );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicDecrementUnsafe( int64_t volatile & rAtomic );
 
 	/// Atomically add a value to a 64-bit integer, with full memory barriers.
 	///
@@ -437,7 +450,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to add.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicAdd( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicAdd( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically add a value to a 64-bit integer, with acquire semantics.
 	///
@@ -445,7 +458,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to add.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicAddAcquire( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicAddAcquire( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically add a value to a 64-bit integer, with release semantics.
 	///
@@ -453,7 +466,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to add.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicAddRelease( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicAddRelease( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically add a value to a 64-bit integer, without any memory barriers.
 	///
@@ -461,7 +474,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to add.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicAddUnsafe( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicAddUnsafe( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically subtract a value from a 64-bit integer, with full memory barriers.
 	///
@@ -469,7 +482,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to subtract.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicSubtract( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicSubtract( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically subtract a value from a 64-bit integer, with acquire semantics.
 	///
@@ -477,7 +490,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to subtract.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicSubtractAcquire( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicSubtractAcquire( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically subtract a value from a 64-bit integer, with release semantics.
 	///
@@ -485,7 +498,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to subtract.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicSubtractRelease( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicSubtractRelease( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically subtract a value from a 64-bit integer, without any memory barriers.
 	///
@@ -493,7 +506,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to subtract.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicSubtractUnsafe( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicSubtractUnsafe( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically AND a 64-bit integer with another value, with full memory barriers.
 	///
@@ -501,7 +514,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to AND.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicAnd( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicAnd( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically AND a 64-bit integer with another value, with acquire semantics.
 	///
@@ -509,7 +522,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to AND.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicAndAcquire( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicAndAcquire( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically AND a 64-bit integer with another value, with release semantics.
 	///
@@ -517,7 +530,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to AND.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicAndRelease( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicAndRelease( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically AND a 64-bit integer with another value, without any memory barriers.
 	///
@@ -525,7 +538,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to AND.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicAndUnsafe( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicAndUnsafe( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically OR a 64-bit integer with another value, with full memory barriers.
 	///
@@ -533,7 +546,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to OR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicOr( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicOr( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically OR a 64-bit integer with another value, with acquire semantics.
 	///
@@ -541,7 +554,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to OR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicOrAcquire( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicOrAcquire( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically OR a 64-bit integer with another value, with release semantics.
 	///
@@ -549,7 +562,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to OR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicOrRelease( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicOrRelease( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically OR a 64-bit integer with another value, without any memory barriers.
 	///
@@ -557,7 +570,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to OR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicOrUnsafe( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicOrUnsafe( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically XOR a 64-bit integer with another value, with full memory barriers.
 	///
@@ -565,7 +578,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to XOR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicXor( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicXor( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically XOR a 64-bit integer with another value, with acquire semantics.
 	///
@@ -573,7 +586,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to XOR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicXorAcquire( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicXorAcquire( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically XOR a 64-bit integer with another value, with release semantics.
 	///
@@ -581,7 +594,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to XOR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicXorRelease( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicXorRelease( int64_t volatile & rAtomic, int64_t value );
 
 	/// Atomically XOR a 64-bit integer with another value, without any memory barriers.
 	///
@@ -589,7 +602,7 @@ namespace OpenThreads
 	/// @param[in] value    Value with which to XOR.
 	///
 	/// @return  Original integer value prior to updating.
-	OPENTHREAD_EXPORT_DIRECTIVE int64_t AtomicXorUnsafe( int64_t volatile & rAtomic, int64_t value );
+	OPENTHREAD_ATOMIC_FUNCTION int64_t AtomicXorUnsafe( int64_t volatile & rAtomic, int64_t value );
 	// ---- end 64-bit integer variant
 
 	/// Atomically swap the current value of pointer with another value, with full memory barriers.
@@ -598,7 +611,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to swap.
 	///
 	/// @return  Original pointer value upon swapping.
-	OPENTHREAD_EXPORT_DIRECTIVE void* AtomicExchangePointer( void* volatile & rAtomic, void* value );
+	OPENTHREAD_ATOMIC_FUNCTION void* AtomicExchangePointer( void* volatile & rAtomic, void* value );
 
 	/// Atomically swap the current value of a pointer with another value, with acquire semantics.
 	///
@@ -606,7 +619,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to swap.
 	///
 	/// @return  Original pointer value upon swapping.
-	OPENTHREAD_EXPORT_DIRECTIVE void* AtomicExchangePointerAcquire( void* volatile & rAtomic, void* value );
+	OPENTHREAD_ATOMIC_FUNCTION void* AtomicExchangePointerAcquire( void* volatile & rAtomic, void* value );
 
 	/// Atomically swap the current value of a pointer with another value, with release semantics.
 	///
@@ -614,7 +627,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to swap.
 	///
 	/// @return  Original pointer value upon swapping.
-	OPENTHREAD_EXPORT_DIRECTIVE void* AtomicExchangePointerRelease( void* volatile & rAtomic, void* value );
+	OPENTHREAD_ATOMIC_FUNCTION void* AtomicExchangePointerRelease( void* volatile & rAtomic, void* value );
 
 	/// Atomically swap the current value of a pointer with another value, without any memory barriers.
 	///
@@ -622,7 +635,7 @@ namespace OpenThreads
 	/// @param[in] value    Value to swap.
 	///
 	/// @return  Original pointer value upon swapping.
-	OPENTHREAD_EXPORT_DIRECTIVE void* AtomicExchangePointerUnsafe( void* volatile & rAtomic, void* value );
+	OPENTHREAD_ATOMIC_FUNCTION void* AtomicExchangePointerUnsafe( void* volatile & rAtomic, void* value );
 
 	/// Atomically compare the current value of a pointer with another value, swapping in a different value if
 	/// the values match, with full memory barriers.
@@ -633,7 +646,7 @@ namespace OpenThreads
 	///
 	/// @return  Original pointer value when the comparison occurred.  If this is the same as @c compare, the pointer's
 	///          value will have been updated to match @c value, otherwise it will have been left unchanged.
-	OPENTHREAD_EXPORT_DIRECTIVE void* AtomicCompareExchangePointer( void* volatile & rAtomic, void* value, void* compare );
+	OPENTHREAD_ATOMIC_FUNCTION void* AtomicCompareExchangePointer( void* volatile & rAtomic, void* value, void* compare );
 
 	/// Atomically compare the current value of a pointer with another value, swapping in a different value if
 	/// the values match, with acquire semantics.
@@ -644,7 +657,7 @@ namespace OpenThreads
 	///
 	/// @return  Original pointer value when the comparison occurred.  If this is the same as @c compare, the pointer's
 	///          value will have been updated to match @c value, otherwise it will have been left unchanged.
-	OPENTHREAD_EXPORT_DIRECTIVE void* AtomicCompareExchangePointerAcquire( void* volatile & rAtomic, void* value, void* compare );
+	OPENTHREAD_ATOMIC_FUNCTION void* AtomicCompareExchangePointerAcquire( void* volatile & rAtomic, void* value, void* compare );
 
 	/// Atomically compare the current value of a pointer with another value, swapping in a different value if
 	/// the values match, with release semantics.
@@ -655,7 +668,7 @@ namespace OpenThreads
 	///
 	/// @return  Original pointer value when the comparison occurred.  If this is the same as @c compare, the pointer's
 	///          value will have been updated to match @c value, otherwise it will have been left unchanged.
-	OPENTHREAD_EXPORT_DIRECTIVE void* AtomicCompareExchangePointerRelease( void* volatile & rAtomic, void* value, void* compare );
+	OPENTHREAD_ATOMIC_FUNCTION void* AtomicCompareExchangePointerRelease( void* volatile & rAtomic, void* value, void* compare );
 
 	/// Atomically compare the current value of a pointer with another value, swapping in a different value if
 	/// the values match, without any memory barriers.
@@ -666,7 +679,49 @@ namespace OpenThreads
 	///
 	/// @return  Original pointer value when the comparison occurred.  If this is the same as @c compare, the pointer's
 	///          value will have been updated to match @c value, otherwise it will have been left unchanged.
-	OPENTHREAD_EXPORT_DIRECTIVE void* AtomicCompareExchangePointerUnsafe( void* volatile & rAtomic, void* value, void* compare );
+	OPENTHREAD_ATOMIC_FUNCTION void* AtomicCompareExchangePointerUnsafe( void* volatile & rAtomic, void* value, void* compare );
+
+	/// 128-bit value for AtomicCompareExchange128(), typically a pointer and a version counter.
+#if defined(_MSC_VER)
+	struct __declspec(align(16)) AtomicInt128
+#else
+	struct __attribute__((aligned(16))) AtomicInt128
+#endif
+	{
+		int64_t low;
+		int64_t high;
+	};
+
+	inline bool operator == ( const AtomicInt128& lhs, const AtomicInt128& rhs ) { return lhs.low==rhs.low && lhs.high==rhs.high; }
+	inline bool operator != ( const AtomicInt128& lhs, const AtomicInt128& rhs ) { return !(lhs==rhs); }
+
+	/// Atomically compare the current value of a 128-bit integer with another value, swapping in a different value if
+	/// the values match, with full memory barriers.  Uses cmpxchg16b on x86-64 and the native double-width
+	/// compare-and-swap elsewhere, or a lock where the processor has none.
+	///
+	/// @param[in] rAtomic  Integer to update, 16-byte aligned.
+	/// @param[in] value    Value to swap.
+	/// @param[in] compare  Value against which to compare.
+	///
+	/// @return  Original integer value when the comparison occurred.  If this is the same as @c compare, the integer's
+	///          value will have been updated to match @c value, otherwise it will have been left unchanged.
+	OPENTHREAD_EXPORT_DIRECTIVE AtomicInt128 AtomicCompareExchange128( AtomicInt128 volatile & rAtomic, AtomicInt128 value, AtomicInt128 compare );
+
+	/// Return true if AtomicCompareExchange128() is lock-free on this platform.
+	OPENTHREAD_EXPORT_DIRECTIVE bool AtomicCompareExchange128IsLockFree();
+
+	/// Issue a full memory barrier: no load or store is reordered across it.
+	OPENTHREAD_ATOMIC_FUNCTION void AtomicThreadFence();
+
+	/// Issue an acquire barrier: loads before it are not reordered with loads and stores after it.
+	OPENTHREAD_ATOMIC_FUNCTION void AtomicThreadFenceAcquire();
+
+	/// Issue a release barrier: loads and stores before it are not reordered with stores after it.
+	OPENTHREAD_ATOMIC_FUNCTION void AtomicThreadFenceRelease();
+
+	/// Tell the processor that the calling thread is busy-waiting on a memory location.  Call it once per iteration
+	/// of a spin loop: it saves power and leaves the execution units to the other hyper-thread of the core.
+	inline void SpinPause();
 
 	/// Atomically swap the current value of pointer with another value, with full memory barriers.
 	///
@@ -759,6 +814,99 @@ namespace OpenThreads
     /////////////////////////////////
 }
 
+#if defined(_OPENTHREADS_ATOMIC_USE_GCC_ATOMIC_BUILTINS)
+
+// A sequentially consistent read-modify-write is a full barrier on x86.  Other
+// processors only order it against other atomic operations, the explicit fence
+// also keeps plain loads and stores on their side of it.
+#if defined(__i386__) || defined(__x86_64__)
+    #define _OPENTHREADS_ATOMIC_FULL_BARRIER()
+#else
+    #define _OPENTHREADS_ATOMIC_FULL_BARRIER() __atomic_thread_fence( __ATOMIC_SEQ_CST )
+#endif
+
+// ACTION( ORDER, FAILURE_ORDER ) expands to the builtin call, FAILURE_ORDER
+// being the strongest order allowed for the load of a failed compare-exchange.
+#define _GENERATE_ATOMIC_WORKER( TYPE, OPERATION, PARAM_LIST, ACTION ) \
+    inline TYPE OpenThreads::Atomic##OPERATION PARAM_LIST \
+    { \
+        TYPE result = ACTION( __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ); \
+        _OPENTHREADS_ATOMIC_FULL_BARRIER(); \
+        return result; \
+    } \
+    inline TYPE OpenThreads::Atomic##OPERATION##Acquire PARAM_LIST { return ACTION( __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE ); } \
+    inline TYPE OpenThreads::Atomic##OPERATION##Release PARAM_LIST { return ACTION( __ATOMIC_RELEASE, __ATOMIC_RELAXED ); } \
+    inline TYPE OpenThreads::Atomic##OPERATION##Unsafe PARAM_LIST { return ACTION( __ATOMIC_RELAXED, __ATOMIC_RELAXED ); }
+
+#define _ATOMIC_EXCHANGE( ORDER, FAILURE_ORDER ) __atomic_exchange_n( &rAtomic, value, ORDER )
+#define _ATOMIC_COMPARE_EXCHANGE( ORDER, FAILURE_ORDER ) \
+    ( __atomic_compare_exchange_n( &rAtomic, &compare, value, false, ORDER, FAILURE_ORDER ), compare )
+#define _ATOMIC_INCREMENT( ORDER, FAILURE_ORDER ) __atomic_add_fetch( &rAtomic, 1, ORDER )
+#define _ATOMIC_DECREMENT( ORDER, FAILURE_ORDER ) __atomic_sub_fetch( &rAtomic, 1, ORDER )
+#define _ATOMIC_ADD( ORDER, FAILURE_ORDER ) __atomic_fetch_add( &rAtomic, value, ORDER )
+#define _ATOMIC_SUBTRACT( ORDER, FAILURE_ORDER ) __atomic_fetch_sub( &rAtomic, value, ORDER )
+#define _ATOMIC_AND( ORDER, FAILURE_ORDER ) __atomic_fetch_and( &rAtomic, value, ORDER )
+#define _ATOMIC_OR( ORDER, FAILURE_ORDER ) __atomic_fetch_or( &rAtomic, value, ORDER )
+#define _ATOMIC_XOR( ORDER, FAILURE_ORDER ) __atomic_fetch_xor( &rAtomic, value, ORDER )
+
+#define _GENERATE_ATOMIC_WORKERS( TYPE ) \
+    _GENERATE_ATOMIC_WORKER( TYPE, Exchange, ( TYPE volatile & rAtomic, TYPE value ), _ATOMIC_EXCHANGE ) \
+    _GENERATE_ATOMIC_WORKER( TYPE, CompareExchange, ( TYPE volatile & rAtomic, TYPE value, TYPE compare ), _ATOMIC_COMPARE_EXCHANGE ) \
+    _GENERATE_ATOMIC_WORKER( TYPE, Increment, ( TYPE volatile & rAtomic ), _ATOMIC_INCREMENT ) \
+    _GENERATE_ATOMIC_WORKER( TYPE, Decrement, ( TYPE volatile & rAtomic ), _ATOMIC_DECREMENT ) \
+    _GENERATE_ATOMIC_WORKER( TYPE, Add, ( TYPE volatile & rAtomic, TYPE value ), _ATOMIC_ADD ) \
+    _GENERATE_ATOMIC_WORKER( TYPE, Subtract, ( TYPE volatile & rAtomic, TYPE value ), _ATOMIC_SUBTRACT ) \
+    _GENERATE_ATOMIC_WORKER( TYPE, And, ( TYPE volatile & rAtomic, TYPE value ), _ATOMIC_AND ) \
+    _GENERATE_ATOMIC_WORKER( TYPE, Or, ( TYPE volatile & rAtomic, TYPE value ), _ATOMIC_OR ) \
+    _GENERATE_ATOMIC_WORKER( TYPE, Xor, ( TYPE volatile & rAtomic, TYPE value ), _ATOMIC_XOR )
+
+_GENERATE_ATOMIC_WORKERS( int32_t )
+_GENERATE_ATOMIC_WORKERS( int64_t )
+
+_GENERATE_ATOMIC_WORKER( void*, ExchangePointer, ( void* volatile & rAtomic, void* value ), _ATOMIC_EXCHANGE )
+_GENERATE_ATOMIC_WORKER( void*, CompareExchangePointer, ( void* volatile & rAtomic, void* value, void* compare ), _ATOMIC_COMPARE_EXCHANGE )
+
+#undef _GENERATE_ATOMIC_WORKERS
+#undef _ATOMIC_EXCHANGE
+#undef _ATOMIC_COMPARE_EXCHANGE
+#undef _ATOMIC_INCREMENT
+#undef _ATOMIC_DECREMENT
+#undef _ATOMIC_ADD
+#undef _ATOMIC_SUBTRACT
+#undef _ATOMIC_AND
+#undef _ATOMIC_OR
+#undef _ATOMIC_XOR
+#undef _GENERATE_ATOMIC_WORKER
+#undef _OPENTHREADS_ATOMIC_FULL_BARRIER
+
+void OpenThreads::AtomicThreadFence()
+{
+	__atomic_thread_fence( __ATOMIC_SEQ_CST );
+}
+
+void OpenThreads::AtomicThreadFenceAcquire()
+{
+	__atomic_thread_fence( __ATOMIC_ACQUIRE );
+}
+
+void OpenThreads::AtomicThreadFenceRelease()
+{
+	__atomic_thread_fence( __ATOMIC_RELEASE );
+}
+
+#endif
+
+void OpenThreads::SpinPause()
+{
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+	_mm_pause();
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	__builtin_ia32_pause();
+#elif defined(__GNUC__) && defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
 template< typename T >
 T* OpenThreads::AtomicExchange(T* volatile & rAtomic, T* value)
 {
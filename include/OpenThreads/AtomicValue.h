@@ -0,0 +1,315 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// AtomicValue - typed atomic variable with explicit memory ordering
+// ~~~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_ATOMICVALUE_
+#define _OPENTHREADS_ATOMICVALUE_
+
+#include <OpenThreads/Config>
+#include <OpenThreads/AtomicFunctions.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace OpenThreads {
+
+/**
+ *  Ordering constraints of an atomic operation, from weakest to strongest.  They have the meaning of the C++11
+ *  memory orders of the same name.
+ */
+enum MemoryOrder
+{
+    MEMORY_ORDER_RELAXED,   ///< atomicity only, no ordering of surrounding memory accesses
+    MEMORY_ORDER_CONSUME,   ///< treated as MEMORY_ORDER_ACQUIRE
+    MEMORY_ORDER_ACQUIRE,   ///< later accesses are not moved before a load
+    MEMORY_ORDER_RELEASE,   ///< earlier accesses are not moved after a store
+    MEMORY_ORDER_ACQ_REL,   ///< both, for read-modify-write operations
+    MEMORY_ORDER_SEQ_CST    ///< acquire and release, plus a single total order of all such operations
+};
+
+template<typename T>
+struct AtomicValueStep
+{
+    static const ptrdiff_t value = 1;
+};
+
+template<typename T>
+struct AtomicValueStep<T*>
+{
+    static const ptrdiff_t value = sizeof(T);
+};
+
+template<>
+struct AtomicValueStep<void*>
+{
+    static const ptrdiff_t value = 1;
+};
+
+#if !defined(_OPENTHREADS_ATOMIC_USE_GCC_ATOMIC_BUILTINS)
+
+template<size_t Size> struct AtomicValueInteger;
+template<> struct AtomicValueInteger<4> { typedef int32_t type; };
+template<> struct AtomicValueInteger<8> { typedef int64_t type; };
+
+#endif
+
+/**
+ *  @class AtomicValue
+ *  @brief  Atomic variable of an integral, enum or pointer type, 4 or 8 bytes wide, whose operations take an explicit
+ *          MemoryOrder.
+ *
+ *  Unlike Atomic, which puts a full barrier around every access, each operation only pays for the ordering it asks
+ *  for: load(MEMORY_ORDER_RELAXED) is a plain load, load(MEMORY_ORDER_ACQUIRE) needs no barrier instruction on x86.
+ *  All operations default to MEMORY_ORDER_SEQ_CST.
+ *
+ *  The operations map onto the compiler's __atomic builtins where they are available.  Otherwise they fall back on
+ *  AtomicFunctions, which are at least as strong as the requested order.
+ *
+ *  fetch_add() and fetch_sub() on pointers count in elements, like pointer arithmetic.
+ */
+template<typename T>
+class AtomicValue
+{
+public:
+
+#if defined(_OPENTHREADS_ATOMIC_USE_GCC_ATOMIC_BUILTINS)
+    AtomicValue() : _value() {}
+
+    AtomicValue(T value) : _value(value) {}
+#else
+    AtomicValue() : _value(toInteger(T())) {}
+
+    AtomicValue(T value) : _value(toInteger(value)) {}
+#endif
+
+    T load(MemoryOrder order = MEMORY_ORDER_SEQ_CST) const;
+
+    void store(T value, MemoryOrder order = MEMORY_ORDER_SEQ_CST);
+
+    /**
+     *  Replace the value.
+     *
+     *  @return  The previous value.
+     */
+    T exchange(T value, MemoryOrder order = MEMORY_ORDER_SEQ_CST);
+
+    /**
+     *  Replace the value with desired if it is equal to expected, otherwise load it into expected.  May fail
+     *  spuriously, so it belongs in a retry loop.
+     *
+     *  @return  true if the value was replaced.
+     */
+    bool compare_exchange_weak(T& expected, T desired, MemoryOrder success, MemoryOrder failure);
+
+    bool compare_exchange_weak(T& expected, T desired, MemoryOrder order = MEMORY_ORDER_SEQ_CST)
+    {
+        return compare_exchange_weak(expected, desired, order, failureOrder(order));
+    }
+
+    /**
+     *  Replace the value with desired if it is equal to expected, otherwise load it into expected.  Never fails
+     *  spuriously.
+     *
+     *  @return  true if the value was replaced.
+     */
+    bool compare_exchange_strong(T& expected, T desired, MemoryOrder success, MemoryOrder failure);
+
+    bool compare_exchange_strong(T& expected, T desired, MemoryOrder order = MEMORY_ORDER_SEQ_CST)
+    {
+        return compare_exchange_strong(expected, desired, order, failureOrder(order));
+    }
+
+    /** Add delta and return the previous value.*/
+    T fetch_add(ptrdiff_t delta, MemoryOrder order = MEMORY_ORDER_SEQ_CST);
+
+    /** Subtract delta and return the previous value.*/
+    T fetch_sub(ptrdiff_t delta, MemoryOrder order = MEMORY_ORDER_SEQ_CST) { return fetch_add(-delta, order); }
+
+    /** Bitwise and with mask and return the previous value.*/
+    T fetch_and(T mask, MemoryOrder order = MEMORY_ORDER_SEQ_CST);
+
+    /** Bitwise or with mask and return the previous value.*/
+    T fetch_or(T mask, MemoryOrder order = MEMORY_ORDER_SEQ_CST);
+
+    /** Bitwise xor with mask and return the previous value.*/
+    T fetch_xor(T mask, MemoryOrder order = MEMORY_ORDER_SEQ_CST);
+
+    operator T() const { return load(); }
+
+    T operator = (T value) { store(value); return value; }
+
+    T operator ++ () { return fetch_add(1) + 1; }
+    T operator -- () { return fetch_sub(1) - 1; }
+    T operator ++ (int) { return fetch_add(1); }
+    T operator -- (int) { return fetch_sub(1); }
+
+private:
+
+    AtomicValue(const AtomicValue&);
+    AtomicValue& operator=(const AtomicValue&);
+
+    static MemoryOrder failureOrder(MemoryOrder order)
+    {
+        // a failed compare-exchange only loads
+        if (order==MEMORY_ORDER_ACQ_REL) return MEMORY_ORDER_ACQUIRE;
+        if (order==MEMORY_ORDER_RELEASE) return MEMORY_ORDER_RELAXED;
+        return order;
+    }
+
+#if !defined(_OPENTHREADS_ATOMIC_USE_GCC_ATOMIC_BUILTINS)
+    typedef typename AtomicValueInteger<sizeof(T)>::type Integer;
+
+    static Integer toInteger(T value) { Integer i = 0; memcpy(&i, &value, sizeof(T)); return i; }
+    static T fromInteger(Integer i) { T value; memcpy(&value, &i, sizeof(T)); return value; }
+
+    // the value is kept as an integer of the same size, for AtomicFunctions
+    Integer volatile _value;
+#else
+    T volatile _value;
+#endif
+};
+
+#if defined(_OPENTHREADS_ATOMIC_USE_GCC_ATOMIC_BUILTINS)
+
+template<typename T>
+T AtomicValue<T>::load(MemoryOrder order) const
+{
+    return __atomic_load_n(&_value, static_cast<int>(order));
+}
+
+template<typename T>
+void AtomicValue<T>::store(T value, MemoryOrder order)
+{
+    __atomic_store_n(&_value, value, static_cast<int>(order));
+}
+
+template<typename T>
+T AtomicValue<T>::exchange(T value, MemoryOrder order)
+{
+    return __atomic_exchange_n(&_value, value, static_cast<int>(order));
+}
+
+template<typename T>
+bool AtomicValue<T>::compare_exchange_weak(T& expected, T desired, MemoryOrder success, MemoryOrder failure)
+{
+    return __atomic_compare_exchange_n(&_value, &expected, desired, true, static_cast<int>(success), static_cast<int>(failure));
+}
+
+template<typename T>
+bool AtomicValue<T>::compare_exchange_strong(T& expected, T desired, MemoryOrder success, MemoryOrder failure)
+{
+    return __atomic_compare_exchange_n(&_value, &expected, desired, false, static_cast<int>(success), static_cast<int>(failure));
+}
+
+template<typename T>
+T AtomicValue<T>::fetch_add(ptrdiff_t delta, MemoryOrder order)
+{
+    // the builtins add bytes to pointers
+    return __atomic_fetch_add(&_value, delta * AtomicValueStep<T>::value, static_cast<int>(order));
+}
+
+template<typename T>
+T AtomicValue<T>::fetch_and(T mask, MemoryOrder order)
+{
+    return __atomic_fetch_and(&_value, mask, static_cast<int>(order));
+}
+
+template<typename T>
+T AtomicValue<T>::fetch_or(T mask, MemoryOrder order)
+{
+    return __atomic_fetch_or(&_value, mask, static_cast<int>(order));
+}
+
+template<typename T>
+T AtomicValue<T>::fetch_xor(T mask, MemoryOrder order)
+{
+    return __atomic_fetch_xor(&_value, mask, static_cast<int>(order));
+}
+
+#else
+
+// Fallback on the full barrier AtomicFunctions, plain loads and stores get
+// the fences their order asks for.
+
+template<typename T>
+T AtomicValue<T>::load(MemoryOrder order) const
+{
+    if (order==MEMORY_ORDER_SEQ_CST) AtomicThreadFence();
+    Integer value = _value;
+    if (order!=MEMORY_ORDER_RELAXED) AtomicThreadFenceAcquire();
+    return fromInteger(value);
+}
+
+template<typename T>
+void AtomicValue<T>::store(T value, MemoryOrder order)
+{
+    if (order!=MEMORY_ORDER_RELAXED) AtomicThreadFenceRelease();
+    _value = toInteger(value);
+    if (order==MEMORY_ORDER_SEQ_CST) AtomicThreadFence();
+}
+
+template<typename T>
+T AtomicValue<T>::exchange(T value, MemoryOrder /*order*/)
+{
+    return fromInteger(AtomicExchange(_value, toInteger(value)));
+}
+
+template<typename T>
+bool AtomicValue<T>::compare_exchange_weak(T& expected, T desired, MemoryOrder success, MemoryOrder failure)
+{
+    return compare_exchange_strong(expected, desired, success, failure);
+}
+
+template<typename T>
+bool AtomicValue<T>::compare_exchange_strong(T& expected, T desired, MemoryOrder /*success*/, MemoryOrder /*failure*/)
+{
+    Integer compare = toInteger(expected);
+    Integer previous = AtomicCompareExchange(_value, toInteger(desired), compare);
+    if (previous==compare) return true;
+    expected = fromInteger(previous);
+    return false;
+}
+
+template<typename T>
+T AtomicValue<T>::fetch_add(ptrdiff_t delta, MemoryOrder /*order*/)
+{
+    return fromInteger(AtomicAdd(_value, static_cast<Integer>(delta * AtomicValueStep<T>::value)));
+}
+
+template<typename T>
+T AtomicValue<T>::fetch_and(T mask, MemoryOrder /*order*/)
+{
+    return fromInteger(AtomicAnd(_value, toInteger(mask)));
+}
+
+template<typename T>
+T AtomicValue<T>::fetch_or(T mask, MemoryOrder /*order*/)
+{
+    return fromInteger(AtomicOr(_value, toInteger(mask)));
+}
+
+template<typename T>
+T AtomicValue<T>::fetch_xor(T mask, MemoryOrder /*order*/)
+{
+    return fromInteger(AtomicXor(_value, toInteger(mask)));
+}
+
+#endif
+
+}
+
+#endif // _OPENTHREADS_ATOMICVALUE_
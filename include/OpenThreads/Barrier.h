@@ -38,10 +38,23 @@ class OPENTHREAD_EXPORT_DIRECTIVE Barrier {
 
 public:
 
+    /**
+     *  How threads wait for the others in block().
+     */
+    enum BarrierType
+    {
+        BARRIER_BLOCKING, /**< Sleep on a mutex/condition pair, the default.                  */
+        BARRIER_SPIN,     /**< Busy-wait, for very short phases with a thread per core.      */
+        BARRIER_HYBRID    /**< Busy-wait for a moment, then sleep until the last thread comes. */
+    };
+
     /**
      *  Constructor
+     *
+     *  @note BARRIER_SPIN and BARRIER_HYBRID are implemented by the pthreads
+     *  model only, others fall back to BARRIER_BLOCKING.
      */
-    Barrier(int numThreads=0);
+    Barrier(int numThreads=0, BarrierType type=BARRIER_BLOCKING);
 
     /**
      *  Destructor
@@ -72,6 +85,12 @@ public:
 
     void invalidate();
 
+    /**
+     *  Return the wait strategy in use, which may differ from the one
+     *  requested if the threading model does not support it.
+     */
+    BarrierType getBarrierType() const { return _barrierType; }
+
 private:
 
     /**
@@ -92,6 +111,8 @@ private:
 
     bool _valid;
 
+    BarrierType _barrierType;
+
 };
 
 }
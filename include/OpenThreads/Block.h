@@ -18,16 +18,24 @@
 #include <OpenThreads/Barrier.h>
 #include <OpenThreads/Condition.h>
 #include <OpenThreads/ScopedLock.h>
+#include <OpenThreads/AtomicFunctions.h>
+#include <OpenThreads/Futex.h>
 
 namespace OpenThreads {
 
-/** Block is a block that can be used to halt a thread that is waiting another thread to release it.*/
+/** Block is a block that can be used to halt a thread that is waiting another thread to release it.
+  *
+  * release() on a Block nobody waits for is one atomic exchange and block() on a released Block
+  * is a single load.  Sleepers wait on a generation word that every release() bumps, so that the
+  * threads waiting at a release() get through even if reset() follows before they wake up.*/
 class Block
 {
     public:
 
         Block():
-            _released(false) {}
+            _released(0),
+            _generation(0),
+            _waiters(0) {}
 
         ~Block()
         {
@@ -36,49 +44,63 @@ class Block
 
         inline bool block()
         {
-            ScopedLock<OpenThreads::Mutex> mutlock(_mut);
-            if( !_released )
-            {
-                return _cond.wait(&_mut)==0;
-            }
-            else
-            {
-                return true;
-            }
+            if (_released) return true;
+
+            int32_t generation;
+            if (!beginWait(generation)) return true;
+
+            while (_generation==generation) FutexWait(_generation, generation);
+
+            AtomicDecrement(_waiters);
+            return true;
         }
 
         inline bool block(unsigned long timeout)
         {
-            ScopedLock<OpenThreads::Mutex> mutlock(_mut);
-            if( !_released )
-            {
-                return _cond.wait(&_mut, timeout)==0;
-            }
-            else
+            if (_released) return true;
+
+            // saturate, ULONG_MAX milliseconds must not wrap around into the past
+            uint64_t now = Condition::getMonotonicTime();
+            uint64_t timeoutNs = timeout < (~now - 999999u)/1000000u ? static_cast<uint64_t>(timeout)*1000000u : ~now;
+            uint64_t deadline = now + timeoutNs;
+
+            int32_t generation;
+            if (!beginWait(generation)) return true;
+
+            bool released = true;
+            while (_generation==generation)
             {
-                return true;
+                now = Condition::getMonotonicTime();
+                if (now>=deadline)
+                {
+                    released = false;
+                    break;
+                }
+                FutexWait(_generation, generation, deadline - now);
             }
+
+            AtomicDecrement(_waiters);
+            return released;
         }
 
         inline void release()
         {
-            ScopedLock<OpenThreads::Mutex> mutlock(_mut);
-            if (!_released)
+            if (!_released && AtomicExchange(_released, 1)==0)
             {
-                _released = true;
-                _cond.broadcast();
+                // full barrier: either a waiter sees the new generation, or we see the waiter
+                AtomicIncrement(_generation);
+                if (_waiters!=0) FutexWakeAll(_generation);
             }
         }
 
         inline void reset()
         {
-            ScopedLock<OpenThreads::Mutex> mutlock(_mut);
-            _released = false;
+            AtomicCompareExchange(_released, 0, 1);
         }
 
         inline void set(bool doRelease)
         {
-            if (doRelease!=_released)
+            if (doRelease!=(_released!=0))
             {
                 if (doRelease) release();
                 else reset();
@@ -87,23 +109,44 @@ class Block
 
     protected:
 
-        Mutex _mut;
-        Condition _cond;
-        bool _released;
+        // register as a waiter and read the generation to wait on, false if released meanwhile
+        inline bool beginWait(int32_t& generation)
+        {
+            // full barrier, paired with the ones of release()
+            AtomicIncrement(_waiters);
+            generation = _generation;
+            AtomicThreadFenceAcquire();
+            if (_released)
+            {
+                AtomicDecrement(_waiters);
+                return false;
+            }
+            return true;
+        }
+
+        int32_t volatile _released;
+        int32_t volatile _generation;
+        int32_t volatile _waiters;
 
     private:
 
         Block(const Block&) {}
 };
 
-/** BlockCount is a block that can be used to halt a thread that is waiting for a specified number of operations to be completed.*/
+/** BlockCount is a block that can be used to halt a thread that is waiting for a specified number of operations to be completed.
+  *
+  * completed() is a single compare-and-swap on the counter, only the completion that brings it
+  * down to zero bumps the generation word that sleepers wait on and wakes them up.  Waiters
+  * present when the count reaches zero get through even if reset() follows straight away.*/
 class BlockCount
 {
     public:
 
         BlockCount(unsigned int blockCount):
             _blockCount(blockCount),
-            _currentCount(0) {}
+            _currentCount(0),
+            _generation(0),
+            _waiters(0) {}
 
         ~BlockCount()
         {
@@ -113,43 +156,45 @@ class BlockCount
 
         inline void completed()
         {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> mutlock(_mut);
-            if (_currentCount>0)
+            for(int32_t count = _currentCount; count>0; count = _currentCount)
             {
-                --_currentCount;
-
-                if (_currentCount==0)
+                if (AtomicCompareExchange(_currentCount, count-1, count)==count)
                 {
-                    // osg::notify(osg::NOTICE)<<"Released"<<std::endl;
-                    _cond.broadcast();
+                    if (count==1) wakeWaiters();
+                    return;
                 }
             }
         }
 
         inline void block()
         {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> mutlock(_mut);
-            if (_currentCount)
-                _cond.wait(&_mut);
+            if (_currentCount==0) return;
+
+            // full barrier: either the completion that reaches zero sees us, or we see its zero
+            AtomicIncrement(_waiters);
+            int32_t generation = _generation;
+            AtomicThreadFenceAcquire();
+            if (_currentCount!=0)
+            {
+                while (_generation==generation) FutexWait(_generation, generation);
+            }
+            AtomicDecrement(_waiters);
         }
 
         inline void reset()
         {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> mutlock(_mut);
-            if (_currentCount!=_blockCount)
+            if (_currentCount!=static_cast<int32_t>(_blockCount))
             {
-                if (_blockCount==0) _cond.broadcast();
-                _currentCount = _blockCount;
+                AtomicExchange(_currentCount, static_cast<int32_t>(_blockCount));
+                if (_blockCount==0) wakeWaiters();
             }
         }
 
         inline void release()
         {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> mutlock(_mut);
-            if (_currentCount)
+            if (_currentCount!=0 && AtomicExchange(_currentCount, 0)!=0)
             {
-                _currentCount = 0;
-                _cond.broadcast();
+                wakeWaiters();
             }
         }
 
@@ -157,14 +202,20 @@ class BlockCount
 
         inline unsigned int getBlockCount() const { return _blockCount; }
 
-        inline unsigned int getCurrentCount() const { return _currentCount; }
+        inline unsigned int getCurrentCount() const { return static_cast<unsigned int>(_currentCount); }
 
     protected:
 
-        OpenThreads::Mutex _mut;
-        OpenThreads::Condition _cond;
+        inline void wakeWaiters()
+        {
+            AtomicIncrement(_generation);
+            if (_waiters!=0) FutexWakeAll(_generation);
+        }
+
         unsigned int _blockCount;
-        unsigned int _currentCount;
+        int32_t volatile _currentCount;
+        int32_t volatile _generation;
+        int32_t volatile _waiters;
 
     private:
 
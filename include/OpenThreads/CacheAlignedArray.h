@@ -0,0 +1,107 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// CacheAlignedArray - fixed size array starting on a cache line boundary, and
+//                     allocation of over-aligned storage
+// ~~~~~~~~~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_CACHEALIGNEDARRAY_
+#define _OPENTHREADS_CACHEALIGNEDARRAY_
+
+#include <OpenThreads/Config>
+#include <cstddef>
+#include <new>
+
+namespace OpenThreads {
+
+/** Return the smallest power of two not below value, to size arrays of per-thread slots indexed with a mask.*/
+inline unsigned int RoundUpToPowerOfTwo(unsigned int value)
+{
+    unsigned int result = 1;
+    while (result<value) result <<= 1;
+    return result;
+}
+
+/**
+ *  Allocate size bytes aligned to alignment, a power of two, for storage of a type whose alignment operator new may
+ *  not honour before C++17.  For a stricter than fundamental alignment the block is over-allocated and its address
+ *  kept in front of the returned memory.  Give the memory back with DeallocateAligned() and the same alignment.
+ */
+inline void* AllocateAligned(size_t size, size_t alignment)
+{
+    if (alignment<=alignof(std::max_align_t)) return ::operator new(size);
+
+    char* block = static_cast<char*>(::operator new(size + alignment + sizeof(void*)));
+    size_t address = reinterpret_cast<size_t>(block + sizeof(void*));
+    char* memory = block + sizeof(void*) + (alignment - address % alignment) % alignment;
+    reinterpret_cast<void**>(memory)[-1] = block;
+    return memory;
+}
+
+inline void DeallocateAligned(void* memory, size_t alignment)
+{
+    if (alignment<=alignof(std::max_align_t)) ::operator delete(memory);
+    else if (memory) ::operator delete(static_cast<void**>(memory)[-1]);
+}
+
+/**
+ *  @class CacheAlignedArray
+ *  @brief  Array of value-initialised elements whose first element starts on a cache line boundary, or on the
+ *          alignment of T if that is stricter.
+ *
+ *  The storage comes from AllocateAligned().  With elements padded to a multiple of OPENTHREADS_CACHE_LINE_SIZE, as the
+ *  per-thread slots of ShardedCounter or ObjectPool are, each element then has cache lines of its own.
+ */
+template<typename T>
+class CacheAlignedArray
+{
+public:
+
+    enum
+    {
+        ALIGNMENT = alignof(T)>OPENTHREADS_CACHE_LINE_SIZE ? alignof(T) : OPENTHREADS_CACHE_LINE_SIZE
+    };
+
+    explicit CacheAlignedArray(size_t size) :
+        _size(size),
+        _elements(static_cast<T*>(AllocateAligned(size*sizeof(T), ALIGNMENT)))
+    {
+        for(size_t i=0; i<size; ++i) new (&_elements[i]) T();
+    }
+
+    ~CacheAlignedArray()
+    {
+        for(size_t i=0; i<_size; ++i) _elements[i].~T();
+        DeallocateAligned(_elements, ALIGNMENT);
+    }
+
+    T& operator[](size_t index) { return _elements[index]; }
+    const T& operator[](size_t index) const { return _elements[index]; }
+
+    size_t size() const { return _size; }
+
+private:
+
+    CacheAlignedArray(const CacheAlignedArray&);
+    CacheAlignedArray& operator=(const CacheAlignedArray&);
+
+    size_t  _size;
+    T*      _elements;
+};
+
+}
+
+#endif // _OPENTHREADS_CACHEALIGNEDARRAY_
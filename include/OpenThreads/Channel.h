@@ -0,0 +1,325 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// Channel - Go style channels, and select over several of them
+// ~~~~~~~
+//
+
+#ifndef _OPENTHREADS_CHANNEL_
+#define _OPENTHREADS_CHANNEL_
+
+#include <OpenThreads/CacheAlignedArray.h>
+#include <OpenThreads/Exports.h>
+#include <OpenThreads/Mutex.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+#include <vector>
+
+namespace OpenThreads {
+
+class ChannelBase;
+
+/**
+ *  One send or receive of a ChannelBase::select().  value points to the T to send, or to the T that receives.
+ */
+struct ChannelCase
+{
+    ChannelBase*    channel;
+    void*           value;
+    bool            send;
+};
+
+/**
+ *  @class ChannelBase
+ *  @brief  Type independent part of Channel: the lock, the queues of waiting threads and select().
+ *
+ *  A thread that has to wait, in a plain send or receive or in a select over several channels, parks on a single
+ *  record on its stack and puts one node per case in the queues of the channels involved.  The first thread that can
+ *  complete one of the cases claims the record with a compare-and-swap, transfers the value directly to or from the
+ *  waiting thread and wakes it up with a futex.  The other channels discard the stale nodes.
+ */
+class OPENTHREAD_EXPORT_DIRECTIVE ChannelBase
+{
+public:
+
+    /** Results of select() when no case completed.*/
+    enum
+    {
+        SELECT_TIMEOUT = -1,
+        SELECT_WOULD_BLOCK = -2
+    };
+
+    /**
+     *  Close the channel.  Waiting and later senders fail.  Receivers get the elements still buffered, then fail.
+     *  Closing a closed channel does nothing.
+     */
+    void close();
+
+    bool isClosed() const;
+
+    /** Return the number of buffered elements, only a hint while other threads use the channel.*/
+    size_t size() const;
+
+    size_t getCapacity() const { return _capacity; }
+
+    /**
+     *  Complete exactly one of count cases, the first one that can among cases taken in a varying order, so that a
+     *  busy channel does not starve the others.
+     *
+     *  @param block      If false, return SELECT_WOULD_BLOCK straight away when no case can complete.
+     *  @param timeoutNs  If not 0, wait at most this many nanoseconds and return SELECT_TIMEOUT.
+     *  @param closed     Set to true if the case completed because its channel is closed: a send that failed or a
+     *                    receive that got no value.
+     *
+     *  @return  The index of the completed case, or SELECT_TIMEOUT or SELECT_WOULD_BLOCK.
+     */
+    static int select(const ChannelCase* cases, unsigned int count, bool block, const uint64_t* timeoutNs, bool& closed);
+
+protected:
+
+    explicit ChannelBase(size_t capacity);
+
+    /**
+     *  No thread may wait on the channel any more.
+     */
+    virtual ~ChannelBase();
+
+    /** Append a copy of *value to the buffer, which has room.  Called with the lock held.*/
+    virtual void pushValue(const void* value) = 0;
+
+    /** Move the oldest buffered element to *value.  Called with the lock held.*/
+    virtual void popValue(void* value) = 0;
+
+    /** Assign *source to *destination, to hand a value directly from a sender to a receiver.*/
+    virtual void copyValue(void* destination, const void* source) = 0;
+
+    // number of buffered elements, maintained by ChannelBase
+    size_t          _count;
+
+private:
+
+    struct Waiter;
+    struct WaitNode;
+    struct Locks;
+
+    struct WaitList
+    {
+        WaitList() : first(0), last(0) {}
+
+        WaitNode*   first;
+        WaitNode*   last;
+    };
+
+    enum Result
+    {
+        NOT_READY,
+        COMPLETED,
+        CLOSED
+    };
+
+    ChannelBase(const ChannelBase&);
+    ChannelBase& operator=(const ChannelBase&);
+
+    Result sendLocked(const void* value);
+    Result receiveLocked(void* value);
+
+    static void enqueue(WaitList& list, WaitNode* node);
+    static void unlink(WaitList& list, WaitNode* node);
+    static WaitNode* dequeueClaimed(WaitList& list);
+    static void unclaim(WaitList& list, WaitNode* node);
+    static void complete(WaitNode* node, bool closed);
+
+    mutable Mutex   _mutex;
+    const size_t    _capacity;
+    bool            _closed;
+    WaitList        _senders;
+    WaitList        _receivers;
+};
+
+/**
+ *  @class Channel
+ *  @brief  FIFO between threads in the style of Go channels.
+ *
+ *  With a capacity of 0 the channel is unbuffered: a send completes only when a receiver takes the value.  Otherwise
+ *  up to capacity elements are buffered and a send only waits while the buffer is full.  A closed channel refuses
+ *  sends and lets receivers drain the buffer.  ChannelSelect waits on several channels at once.
+ *
+ *  Blocking operations park the calling thread, they can be used from Thread::run() bodies and from pool tasks alike.
+ *  A channel must not be destroyed while threads wait on it.
+ *
+ *  If copying a T throws, the exception propagates out of the send or receive that made the copy, which did not take
+ *  place, and threads waiting on the channel keep waiting.
+ */
+template<typename T>
+class Channel : public ChannelBase
+{
+public:
+
+    explicit Channel(size_t capacity = 0) :
+        ChannelBase(capacity),
+        _first(0),
+        _slots(capacity ? static_cast<T*>(AllocateAligned(capacity * sizeof(T), alignof(T))) : 0) {}
+
+    virtual ~Channel()
+    {
+        for(size_t i=0; i<_count; ++i) _slots[(_first + i) % getCapacity()].~T();
+        DeallocateAligned(_slots, alignof(T));
+    }
+
+    /**
+     *  Send a copy of value, waiting for a receiver or for room in the buffer.
+     *
+     *  @return  false if the channel is closed.
+     */
+    bool send(const T& value) { return operate(const_cast<T*>(&value), true, true, 0); }
+
+    /**
+     *  Send a copy of value if a receiver waits or the buffer has room.
+     *
+     *  @return  false if the value was not sent.
+     */
+    bool trySend(const T& value) { return operate(const_cast<T*>(&value), true, false, 0); }
+
+    /**
+     *  Send a copy of value, waiting at most timeoutNs nanoseconds.
+     *
+     *  @return  false if the value was not sent, because of the timeout or because the channel is closed.
+     */
+    bool sendFor(const T& value, uint64_t timeoutNs) { return operate(const_cast<T*>(&value), true, true, &timeoutNs); }
+
+    /**
+     *  Receive the oldest value, waiting for one.
+     *
+     *  @return  false if the channel is closed and empty.
+     */
+    bool receive(T& value) { return operate(&value, false, true, 0); }
+
+    /**
+     *  Receive the oldest value if one is buffered or a sender waits.
+     *
+     *  @return  false if no value was received.
+     */
+    bool tryReceive(T& value) { return operate(&value, false, false, 0); }
+
+    /**
+     *  Receive the oldest value, waiting at most timeoutNs nanoseconds.
+     *
+     *  @return  false if no value was received, because of the timeout or because the channel is closed and empty.
+     */
+    bool receiveFor(T& value, uint64_t timeoutNs) { return operate(&value, false, true, &timeoutNs); }
+
+protected:
+
+    virtual void pushValue(const void* value)
+    {
+        new (&_slots[(_first + _count) % getCapacity()]) T(*static_cast<const T*>(value));
+    }
+
+    virtual void popValue(void* value)
+    {
+        T* slot = &_slots[_first];
+        *static_cast<T*>(value) = *slot;
+        slot->~T();
+        _first = (_first + 1) % getCapacity();
+    }
+
+    virtual void copyValue(void* destination, const void* source)
+    {
+        *static_cast<T*>(destination) = *static_cast<const T*>(source);
+    }
+
+private:
+
+    bool operate(T* value, bool send, bool block, const uint64_t* timeoutNs)
+    {
+        ChannelCase channelCase = { this, value, send };
+        bool closed = false;
+        return select(&channelCase, 1, block, timeoutNs, closed)==0 && !closed;
+    }
+
+    size_t  _first;
+    T*      _slots;
+};
+
+/**
+ *  @class ChannelSelect
+ *  @brief  Wait on sends and receives over several channels and complete exactly one of them, like Go's select.
+ *
+ *  @code
+ *  ChannelSelect select;
+ *  int jobCase = select.addReceive(jobs, job);
+ *  int quitCase = select.addReceive(quit, signal);
+ *  int result = select.waitFor(100000000);
+ *  if (result==jobCase && !select.wasClosed()) process(job);
+ *  @endcode
+ *
+ *  The values passed to addSend() and addReceive() are referenced, not copied, and must outlive the wait.  The same
+ *  ChannelSelect can wait many times.
+ */
+class ChannelSelect
+{
+public:
+
+    enum
+    {
+        TIMEOUT = ChannelBase::SELECT_TIMEOUT,
+        WOULD_BLOCK = ChannelBase::SELECT_WOULD_BLOCK
+    };
+
+    ChannelSelect() : _closed(false) {}
+
+    /** Add a case sending value to channel.  @return  The index of the case.*/
+    template<typename T>
+    int addSend(Channel<T>& channel, const T& value) { return addCase(&channel, const_cast<T*>(&value), true); }
+
+    /** Add a case receiving from channel into value.  @return  The index of the case.*/
+    template<typename T>
+    int addReceive(Channel<T>& channel, T& value) { return addCase(&channel, &value, false); }
+
+    /** Wait until a case completes.  @return  Its index.*/
+    int wait() { return ChannelBase::select(cases(), numCases(), true, 0, _closed); }
+
+    /** Wait at most timeoutNs nanoseconds.  @return  The index of the completed case, or TIMEOUT.*/
+    int waitFor(uint64_t timeoutNs) { return ChannelBase::select(cases(), numCases(), true, &timeoutNs, _closed); }
+
+    /** Complete a case only if one is ready.  @return  Its index, or WOULD_BLOCK.*/
+    int tryWait() { return ChannelBase::select(cases(), numCases(), false, 0, _closed); }
+
+    /** Return true if the last completed case found its channel closed, and transferred no value.*/
+    bool wasClosed() const { return _closed; }
+
+    void clear() { _cases.clear(); }
+
+private:
+
+    int addCase(ChannelBase* channel, void* value, bool send)
+    {
+        ChannelCase channelCase = { channel, value, send };
+        _cases.push_back(channelCase);
+        return static_cast<int>(_cases.size()) - 1;
+    }
+
+    const ChannelCase* cases() const { return _cases.empty() ? 0 : &_cases.front(); }
+
+    unsigned int numCases() const { return static_cast<unsigned int>(_cases.size()); }
+
+    std::vector<ChannelCase>    _cases;
+    bool                        _closed;
+};
+
+}
+
+#endif // _OPENTHREADS_CHANNEL_
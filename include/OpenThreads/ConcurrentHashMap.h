@@ -0,0 +1,452 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// ConcurrentHashMap - hash map with lock-free lookups
+// ~~~~~~~~~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_CONCURRENTHASHMAP_
+#define _OPENTHREADS_CONCURRENTHASHMAP_
+
+#include <OpenThreads/AtomicValue.h>
+#include <OpenThreads/Mutex.h>
+#include <OpenThreads/Rcu.h>
+#include <OpenThreads/ScopedLock.h>
+#include <OpenThreads/ShardedCounter.h>
+#include <OpenThreads/Thread.h>
+#include <functional>
+#include <stddef.h>
+
+namespace OpenThreads {
+
+/**
+ *  @class ConcurrentHashMap
+ *  @brief  Hash map for many concurrent readers and writers.
+ *
+ *  Lookups take no lock and write no shared memory: they run inside an RcuDomain read-side section.  Writers lock
+ *  one of a fixed set of stripes, picked from the hash, so writers to different stripes do not contend.
+ *
+ *  Entries are immutable.  insertOrAssign() replaces the entry with a new one and erase() unlinks it, and the old
+ *  entry is handed to the RcuDomain, which deletes it once no lookup can still be reading it.  A lookup therefore sees
+ *  either the old or the new value, never a partly written one.
+ *
+ *  The table doubles when it holds more than two entries per bucket on average.  The resize is incremental: the new
+ *  table is published next to the old one and buckets are moved one by one, by the writers that touch them and in
+ *  small batches after every write, while lookups and writes keep going.
+ *
+ *  K and V must be copy constructible.  Hash and Equal are function objects like std::hash and std::equal_to.
+ */
+template<typename K, typename V, typename Hash = std::hash<K>, typename Equal = std::equal_to<K> >
+class ConcurrentHashMap
+{
+public:
+
+    /**
+     *  Create an empty map with at least initialBuckets buckets and numStripes writer locks, both rounded up to a
+     *  power of two.  By default there are four stripes per processor.
+     */
+    explicit ConcurrentHashMap(size_t initialBuckets = 64, unsigned int numStripes = 0,
+                               RcuDomain& domain = RcuDomain::getDefault()) :
+        _domain(domain)
+    {
+        if (numStripes==0) numStripes = 4 * static_cast<unsigned int>(GetNumberOfProcessors());
+
+        unsigned int stripes = 1;
+        while (stripes<numStripes) stripes <<= 1;
+        _stripeMask = stripes - 1;
+        _stripes = new Mutex[stripes];
+
+        // a bucket must never span two stripes
+        size_t buckets = stripes;
+        while (buckets<initialBuckets) buckets <<= 1;
+        _table.store(new Table(buckets), MEMORY_ORDER_RELEASE);
+    }
+
+    /**
+     *  Delete all entries.  No other thread may use the map any more.
+     */
+    ~ConcurrentHashMap()
+    {
+        Table* table = _table.load();
+        while (table)
+        {
+            for(size_t i=0; i<=table->mask; ++i)
+            {
+                Node* node = table->buckets[i].load(MEMORY_ORDER_RELAXED);
+                if (node==moved()) continue;
+                while (node)
+                {
+                    Node* next = node->next.load(MEMORY_ORDER_RELAXED);
+                    delete node;
+                    node = next;
+                }
+            }
+
+            Table* next = table->next.load();
+            delete table;
+            table = next;
+        }
+        delete [] _stripes;
+    }
+
+    /**
+     *  Look up key without locking.
+     *
+     *  @return  true, and a copy of the value in value, if the key is present.
+     */
+    bool find(const K& key, V& value) const
+    {
+        ScopedRcuReadLock lock(_domain);
+        const Node* node = findNode(key, hashOf(key));
+        if (!node) return false;
+        value = node->value;
+        return true;
+    }
+
+    bool contains(const K& key) const
+    {
+        ScopedRcuReadLock lock(_domain);
+        return findNode(key, hashOf(key))!=0;
+    }
+
+    /**
+     *  Insert key with value unless the key is present.
+     *
+     *  @return  true if the entry was inserted.
+     */
+    bool insert(const K& key, const V& value)
+    {
+        ScopedRcuReadLock lock(_domain);
+        size_t hash = hashOf(key);
+        bool inserted;
+        {
+            ScopedLock<Mutex> stripeLock(stripeOf(hash));
+            Link link = lockedFind(key, hash);
+            inserted = !link.node;
+            if (inserted) link.insert(new Node(key, value, hash));
+        }
+        afterWrite(inserted ? 1 : 0);
+        return inserted;
+    }
+
+    /**
+     *  Insert key with value, or replace the value of the key if present.
+     *
+     *  @return  true if the entry was inserted, false if it was assigned.
+     */
+    bool insertOrAssign(const K& key, const V& value)
+    {
+        ScopedRcuReadLock lock(_domain);
+        size_t hash = hashOf(key);
+        bool inserted;
+        {
+            ScopedLock<Mutex> stripeLock(stripeOf(hash));
+            Link link = lockedFind(key, hash);
+            inserted = !link.node;
+            if (inserted)
+            {
+                link.insert(new Node(key, value, hash));
+            }
+            else
+            {
+                Node* replacement = new Node(key, value, hash);
+                replacement->next.store(link.node->next.load(MEMORY_ORDER_RELAXED), MEMORY_ORDER_RELAXED);
+                link.pointer->store(replacement, MEMORY_ORDER_RELEASE);
+                _domain.retire(link.node);
+            }
+        }
+        afterWrite(inserted ? 1 : 0);
+        return inserted;
+    }
+
+    /**
+     *  Remove key.
+     *
+     *  @return  true if the key was present.
+     */
+    bool erase(const K& key)
+    {
+        ScopedRcuReadLock lock(_domain);
+        size_t hash = hashOf(key);
+        bool erased;
+        {
+            ScopedLock<Mutex> stripeLock(stripeOf(hash));
+            Link link = lockedFind(key, hash);
+            erased = link.node!=0;
+            if (erased)
+            {
+                link.pointer->store(link.node->next.load(MEMORY_ORDER_RELAXED), MEMORY_ORDER_RELEASE);
+                _domain.retire(link.node);
+            }
+        }
+        afterWrite(erased ? -1 : 0);
+        return erased;
+    }
+
+    /**
+     *  Return the value of key, inserting factory() first if the key is absent.  factory is called at most once,
+     *  with the key's stripe locked, so concurrent callers for the same key never both compute it.
+     */
+    template<class Factory>
+    V computeIfAbsent(const K& key, Factory factory)
+    {
+        {
+            ScopedRcuReadLock lock(_domain);
+            const Node* node = findNode(key, hashOf(key));
+            if (node) return node->value;
+        }
+
+        ScopedRcuReadLock lock(_domain);
+        size_t hash = hashOf(key);
+        Node* node;
+        bool inserted;
+        {
+            ScopedLock<Mutex> stripeLock(stripeOf(hash));
+            Link link = lockedFind(key, hash);
+            node = link.node;
+            inserted = !node;
+            if (inserted)
+            {
+                node = new Node(key, factory(), hash);
+                link.insert(node);
+            }
+        }
+
+        // node stays alive until the read-side section ends
+        V value = node->value;
+        afterWrite(inserted ? 1 : 0);
+        return value;
+    }
+
+    /** Return the number of entries, only a hint while other threads modify the map.*/
+    size_t size() const
+    {
+        int64_t count = _size.read();
+        return count>0 ? static_cast<size_t>(count) : 0;
+    }
+
+    bool empty() const { return size()==0; }
+
+    /** Return the number of buckets of the newest table.*/
+    size_t getBucketCount() const
+    {
+        ScopedRcuReadLock lock(_domain);
+        Table* table = _table.load(MEMORY_ORDER_ACQUIRE);
+        for(Table* next = table->next.load(MEMORY_ORDER_ACQUIRE); next; next = next->next.load(MEMORY_ORDER_ACQUIRE))
+        {
+            table = next;
+        }
+        return table->mask + 1;
+    }
+
+private:
+
+    // buckets moved to the next table per write while a resize is in progress
+    enum { MIGRATION_BATCH = 16 };
+
+    // average number of entries per bucket above which the table doubles
+    enum { MAX_LOAD_FACTOR = 2 };
+
+    struct Node
+    {
+        Node(const K& k, const V& v, size_t h) : key(k), value(v), hash(h) {}
+
+        const K             key;
+        const V             value;
+        const size_t        hash;
+        AtomicValue<Node*>  next;
+    };
+
+    struct Table
+    {
+        explicit Table(size_t size) :
+            mask(size - 1),
+            buckets(new AtomicValue<Node*>[size]) {}
+
+        ~Table() { delete [] buckets; }
+
+        const size_t            mask;
+        AtomicValue<Node*>*     buckets;
+
+        // set while the entries are being moved to a bigger table
+        AtomicValue<Table*>     next;
+        AtomicValue<size_t>     migrationCursor;
+        AtomicValue<size_t>     migratedBuckets;
+    };
+
+    // Position of a key in its bucket chain: the node holding it, if any, and the link that points to it.
+    struct Link
+    {
+        AtomicValue<Node*>* pointer;
+        Node*               node;
+
+        void insert(Node* newNode)
+        {
+            newNode->next.store(pointer->load(MEMORY_ORDER_RELAXED), MEMORY_ORDER_RELAXED);
+            pointer->store(newNode, MEMORY_ORDER_RELEASE);
+        }
+    };
+
+    ConcurrentHashMap(const ConcurrentHashMap&);
+    ConcurrentHashMap& operator=(const ConcurrentHashMap&);
+
+    // bucket value of a bucket that has been moved to the next table
+    static Node* moved()
+    {
+        static char s_moved;
+        return reinterpret_cast<Node*>(&s_moved);
+    }
+
+    size_t hashOf(const K& key) const
+    {
+        // spread the bits, std::hash of an integer is often the integer itself
+        uint64_t hash = static_cast<uint64_t>(_hash(key));
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return static_cast<size_t>(hash);
+    }
+
+    Mutex& stripeOf(size_t hash) const { return _stripes[hash & _stripeMask]; }
+
+    /** Lookup, inside a read-side section.*/
+    const Node* findNode(const K& key, size_t hash) const
+    {
+        Table* table = _table.load(MEMORY_ORDER_ACQUIRE);
+        for(;;)
+        {
+            Node* node = table->buckets[hash & table->mask].load(MEMORY_ORDER_ACQUIRE);
+            if (node==moved())
+            {
+                table = table->next.load(MEMORY_ORDER_ACQUIRE);
+                continue;
+            }
+
+            for(; node; node = node->next.load(MEMORY_ORDER_ACQUIRE))
+            {
+                if (node->hash==hash && _equal(node->key, key)) return node;
+            }
+            return 0;
+        }
+    }
+
+    /** Lookup in the newest table, with the stripe of hash locked and inside a read-side section.*/
+    Link lockedFind(const K& key, size_t hash)
+    {
+        Table* table = _table.load(MEMORY_ORDER_ACQUIRE);
+        for(Table* next = table->next.load(MEMORY_ORDER_ACQUIRE); next; next = table->next.load(MEMORY_ORDER_ACQUIRE))
+        {
+            // move our bucket first, writes only ever go to the newest table
+            size_t index = hash & table->mask;
+            if (table->buckets[index].load(MEMORY_ORDER_RELAXED)!=moved()) migrateBucket(table, next, index);
+            table = next;
+        }
+
+        Link link;
+        link.pointer = &table->buckets[hash & table->mask];
+        for(link.node = link.pointer->load(MEMORY_ORDER_RELAXED); link.node; link.node = link.pointer->load(MEMORY_ORDER_RELAXED))
+        {
+            if (link.node->hash==hash && _equal(link.node->key, key)) break;
+            link.pointer = &link.node->next;
+        }
+        return link;
+    }
+
+    /** Copy the entries of bucket index of table to next, with the bucket's stripe locked.*/
+    void migrateBucket(Table* table, Table* next, size_t index)
+    {
+        AtomicValue<Node*>& bucket = table->buckets[index];
+        Node* first = bucket.load(MEMORY_ORDER_RELAXED);
+
+        // copies, since lookups may still be walking the old chain
+        for(Node* node = first; node; node = node->next.load(MEMORY_ORDER_RELAXED))
+        {
+            Link link;
+            link.pointer = &next->buckets[node->hash & next->mask];
+            link.insert(new Node(node->key, node->value, node->hash));
+        }
+
+        // lookups that arrive from now on go to the next table
+        bucket.store(moved(), MEMORY_ORDER_RELEASE);
+
+        // no writer touches the old chain any more, it goes as a whole
+        if (first) _domain.callRcu(&deleteChain, first);
+
+        if (table->migratedBuckets.fetch_add(1) + 1 == table->mask + 1)
+        {
+            // every bucket has moved
+            _table.store(next, MEMORY_ORDER_RELEASE);
+            _domain.retire(table);
+        }
+    }
+
+    /** Delete a chain left behind by migrateBucket(), once no lookup can still be walking it.*/
+    static void deleteChain(void* first)
+    {
+        for(Node* node = static_cast<Node*>(first); node;)
+        {
+            Node* next = node->next.load(MEMORY_ORDER_RELAXED);
+            delete node;
+            node = next;
+        }
+    }
+
+    /** Update the size, start a resize if needed and help one in progress.  Inside a read-side section.*/
+    void afterWrite(int delta)
+    {
+        if (delta!=0) _size.add(delta);
+
+        Table* table = _table.load(MEMORY_ORDER_ACQUIRE);
+        Table* next = table->next.load(MEMORY_ORDER_ACQUIRE);
+        if (!next)
+        {
+            if (delta>0 && _size.readApproximate() > static_cast<int64_t>(MAX_LOAD_FACTOR * (table->mask + 1)))
+            {
+                startResize(table);
+            }
+            return;
+        }
+
+        size_t start = table->migrationCursor.fetch_add(MIGRATION_BATCH, MEMORY_ORDER_RELAXED);
+        for(size_t index = start; index<start + MIGRATION_BATCH && index<=table->mask; ++index)
+        {
+            ScopedLock<Mutex> stripeLock(_stripes[index & _stripeMask]);
+            if (table->buckets[index].load(MEMORY_ORDER_RELAXED)!=moved()) migrateBucket(table, next, index);
+        }
+    }
+
+    void startResize(Table* table)
+    {
+        ScopedLock<Mutex> lock(_resizeMutex);
+        if (_table.load(MEMORY_ORDER_ACQUIRE)!=table || table->next.load(MEMORY_ORDER_ACQUIRE)) return;
+
+        table->next.store(new Table(2 * (table->mask + 1)), MEMORY_ORDER_RELEASE);
+    }
+
+    RcuDomain&              _domain;
+    Hash                    _hash;
+    Equal                   _equal;
+
+    mutable Mutex*          _stripes;
+    unsigned int            _stripeMask;
+    Mutex                   _resizeMutex;
+
+    AtomicValue<Table*>     _table;
+    ShardedGauge            _size;
+};
+
+}
+
+#endif // _OPENTHREADS_CONCURRENTHASHMAP_
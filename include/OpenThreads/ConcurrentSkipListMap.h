@@ -0,0 +1,625 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// ConcurrentSkipListMap - ordered map and set with lock-free lookups
+// ~~~~~~~~~~~~~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_CONCURRENTSKIPLISTMAP_
+#define _OPENTHREADS_CONCURRENTSKIPLISTMAP_
+
+#include <OpenThreads/AtomicValue.h>
+#include <OpenThreads/Rcu.h>
+#include <OpenThreads/ShardedCounter.h>
+#include <OpenThreads/Thread.h>
+#include <functional>
+#include <cstddef>
+#include <new>
+
+namespace OpenThreads {
+
+/**
+ *  @class ConcurrentSkipListMap
+ *  @brief  Ordered map for many concurrent readers and writers.
+ *
+ *  This is the lazy skip list of Herlihy, Lev, Luchangco and Shavit.  Lookups and iteration take no lock.  insert()
+ *  and erase() lock only the few nodes in front of the key, one per level of the key's node, so writers to different
+ *  parts of the key range do not contend.  An erased node is first marked, then unlinked, and handed to an RcuDomain,
+ *  which deletes it once no reader can still be walking over it.
+ *
+ *  Iteration with forEach() and forEachInRange() is weakly consistent: it visits the keys in order, never visits a
+ *  key twice, visits every entry present for the whole walk, and may or may not visit entries inserted or erased
+ *  during it.  popFirst() turns the map into a concurrent priority queue, for example of timed events.
+ *
+ *  Entries are immutable, K and V must be copy constructible.  Compare is a strict weak order like std::less.
+ */
+template<typename K, typename V, typename Compare = std::less<K> >
+class ConcurrentSkipListMap
+{
+public:
+
+    explicit ConcurrentSkipListMap(RcuDomain& domain = RcuDomain::getDefault()) :
+        _domain(domain)
+    {
+        _head = Node::create(MAX_LEVEL);
+        _head->fullyLinked.store(1, MEMORY_ORDER_RELAXED);
+
+        unsigned int size = 1;
+        while (size<static_cast<unsigned int>(GetNumberOfProcessors())) size <<= 1;
+        _seedMask = size - 1;
+        _seeds = new Seed[size];
+        for(unsigned int i=0; i<size; ++i) _seeds[i].value.store(2654435769u * (i + 1), MEMORY_ORDER_RELAXED);
+    }
+
+    /**
+     *  Delete all entries.  No other thread may use the map any more.
+     */
+    ~ConcurrentSkipListMap()
+    {
+        Node* node = _head->next[0].load();
+        while (node)
+        {
+            Node* next = node->next[0].load(MEMORY_ORDER_RELAXED);
+            Node::destroy(node);
+            node = next;
+        }
+        Node::destroy(_head);
+        delete [] _seeds;
+    }
+
+    /**
+     *  Look up key without locking.
+     *
+     *  @return  true, and a copy of the value in value, if the key is present.
+     */
+    bool find(const K& key, V& value) const
+    {
+        ScopedRcuReadLock lock(_domain);
+        const Node* node = findLive(key);
+        if (!node) return false;
+        value = *node->value();
+        return true;
+    }
+
+    bool contains(const K& key) const
+    {
+        ScopedRcuReadLock lock(_domain);
+        return findLive(key)!=0;
+    }
+
+    /**
+     *  Insert key with value unless the key is present.
+     *
+     *  @return  true if the entry was inserted.
+     */
+    bool insert(const K& key, const V& value)
+    {
+        ScopedRcuReadLock lock(_domain);
+        int topLevel = randomLevel();
+
+        // copy the entry before taking any lock, the copies may throw and are kept across retries
+        Node* node = Node::create(topLevel, key, value);
+
+        Node* preds[MAX_LEVEL];
+        Node* succs[MAX_LEVEL];
+        for(unsigned int attempts = 0;; backoff(attempts))
+        {
+            int levelFound = findNode(key, preds, succs);
+            if (levelFound>=0)
+            {
+                Node* found = succs[levelFound];
+                if (!found->marked.load(MEMORY_ORDER_ACQUIRE))
+                {
+                    // the key is present once its inserter has linked it on every level
+                    for(unsigned int waits = 0; !found->fullyLinked.load(MEMORY_ORDER_ACQUIRE);) backoff(waits);
+                    Node::destroy(node);
+                    return false;
+                }
+
+                // being erased, wait for it to be unlinked
+                continue;
+            }
+
+            int highestLocked = -1;
+            bool valid = true;
+            for(int level = 0; valid && level<topLevel; ++level)
+            {
+                Node* pred = preds[level];
+                Node* succ = succs[level];
+                if (level==0 || pred!=preds[level - 1])
+                {
+                    lockNode(pred);
+                }
+                highestLocked = level;
+                valid = !pred->marked.load(MEMORY_ORDER_RELAXED) &&
+                        (!succ || !succ->marked.load(MEMORY_ORDER_RELAXED)) &&
+                        pred->next[level].load(MEMORY_ORDER_RELAXED)==succ;
+            }
+
+            if (!valid)
+            {
+                unlockPreds(preds, highestLocked);
+                continue;
+            }
+
+            for(int level = 0; level<topLevel; ++level)
+            {
+                node->next[level].store(succs[level], MEMORY_ORDER_RELAXED);
+            }
+            for(int level = 0; level<topLevel; ++level)
+            {
+                preds[level]->next[level].store(node, MEMORY_ORDER_RELEASE);
+            }
+            node->fullyLinked.store(1, MEMORY_ORDER_RELEASE);
+
+            unlockPreds(preds, highestLocked);
+            _size.increment();
+            return true;
+        }
+    }
+
+    /**
+     *  Remove key.
+     *
+     *  @return  true if the key was present.
+     */
+    bool erase(const K& key)
+    {
+        ScopedRcuReadLock lock(_domain);
+        return eraseNode(key, 0);
+    }
+
+    /**
+     *  Copy the entry with the smallest key.
+     *
+     *  @return  false if the map is empty.
+     */
+    bool first(K& key, V& value) const
+    {
+        ScopedRcuReadLock lock(_domain);
+        const Node* node = firstLive(_head->next[0].load(MEMORY_ORDER_ACQUIRE));
+        if (!node) return false;
+        key = *node->key();
+        value = *node->value();
+        return true;
+    }
+
+    /**
+     *  Copy the entry with the smallest key not less than key, for range lookups.
+     *
+     *  @return  false if there is none.
+     */
+    bool lowerBound(const K& key, K& foundKey, V& value) const
+    {
+        ScopedRcuReadLock lock(_domain);
+        const Node* node = firstLive(lowerBoundNode(key));
+        if (!node) return false;
+        foundKey = *node->key();
+        value = *node->value();
+        return true;
+    }
+
+    /**
+     *  Remove the entry with the smallest key and copy it to key and value.  When several threads pop at once, each
+     *  entry goes to exactly one of them.
+     *
+     *  @return  false if the map is empty.
+     */
+    bool popFirst(K& key, V& value)
+    {
+        ScopedRcuReadLock lock(_domain);
+        for(;;)
+        {
+            Node* node = firstLive(_head->next[0].load(MEMORY_ORDER_ACQUIRE));
+            if (!node) return false;
+            if (eraseNode(*node->key(), node))
+            {
+                key = *node->key();
+                value = *node->value();
+                return true;
+            }
+        }
+    }
+
+    /**
+     *  Call visitor(key, value) for every entry in key order.  Weakly consistent, see the class description.
+     */
+    template<class Visitor>
+    void forEach(Visitor visitor) const
+    {
+        ScopedRcuReadLock lock(_domain);
+        for(const Node* node = _head->next[0].load(MEMORY_ORDER_ACQUIRE); node; node = node->next[0].load(MEMORY_ORDER_ACQUIRE))
+        {
+            if (isLive(node)) visitor(*node->key(), *node->value());
+        }
+    }
+
+    /**
+     *  Call visitor(key, value) for every entry with a key in [from, to), in key order.  Weakly consistent.
+     */
+    template<class Visitor>
+    void forEachInRange(const K& from, const K& to, Visitor visitor) const
+    {
+        ScopedRcuReadLock lock(_domain);
+        for(const Node* node = lowerBoundNode(from); node && _less(*node->key(), to); node = node->next[0].load(MEMORY_ORDER_ACQUIRE))
+        {
+            if (isLive(node)) visitor(*node->key(), *node->value());
+        }
+    }
+
+    /** Return the number of entries, only a hint while other threads modify the map.*/
+    size_t size() const
+    {
+        int64_t count = _size.read();
+        return count>0 ? static_cast<size_t>(count) : 0;
+    }
+
+    bool empty() const
+    {
+        ScopedRcuReadLock lock(_domain);
+        return firstLive(_head->next[0].load(MEMORY_ORDER_ACQUIRE))==0;
+    }
+
+private:
+
+    // enough for 4^16 entries, with a quarter of the nodes on each level also on the next one
+    enum { MAX_LEVEL = 16 };
+
+    // pauses before a waiting writer sleeps
+    enum { SPIN_COUNT = 64 };
+
+    struct Node
+    {
+        // the head is a Node without key and value
+        static Node* create(int topLevel)
+        {
+            void* memory = allocate(sizeof(Node) + (topLevel - 1) * sizeof(AtomicValue<Node*>));
+            Node* node = new (memory) Node(topLevel);
+            for(int level = 1; level<topLevel; ++level) new (&node->next[level]) AtomicValue<Node*>();
+            return node;
+        }
+
+        static Node* create(int topLevel, const K& key, const V& value)
+        {
+            Node* node = create(topLevel);
+            try
+            {
+                new (node->keyStorage) K(key);
+                try
+                {
+                    new (node->valueStorage) V(value);
+                }
+                catch(...)
+                {
+                    node->key()->~K();
+                    throw;
+                }
+            }
+            catch(...)
+            {
+                deallocate(node);
+                throw;
+            }
+            node->hasEntry = true;
+            return node;
+        }
+
+        static void destroy(Node* node)
+        {
+            if (node->hasEntry)
+            {
+                node->key()->~K();
+                node->value()->~V();
+            }
+            deallocate(node);
+        }
+
+        static void destroyCallback(void* node) { destroy(static_cast<Node*>(node)); }
+
+        // operator new only honours the fundamental alignment, for a stricter one over-allocate and keep the
+        // address of the block in front of the node
+        static void* allocate(size_t size)
+        {
+            if (alignof(Node)<=alignof(std::max_align_t)) return ::operator new(size);
+
+            char* block = static_cast<char*>(::operator new(size + alignof(Node) + sizeof(void*)));
+            size_t address = reinterpret_cast<size_t>(block + sizeof(void*));
+            char* memory = block + sizeof(void*) + (alignof(Node) - address % alignof(Node)) % alignof(Node);
+            reinterpret_cast<void**>(memory)[-1] = block;
+            return memory;
+        }
+
+        static void deallocate(void* memory)
+        {
+            if (alignof(Node)<=alignof(std::max_align_t)) ::operator delete(memory);
+            else ::operator delete(static_cast<void**>(memory)[-1]);
+        }
+
+        explicit Node(int level) :
+            topLevel(level),
+            hasEntry(false) {}
+
+        const K* key() const { return reinterpret_cast<const K*>(keyStorage); }
+        const V* value() const { return reinterpret_cast<const V*>(valueStorage); }
+        K* key() { return reinterpret_cast<K*>(keyStorage); }
+        V* value() { return reinterpret_cast<V*>(valueStorage); }
+
+        const int                   topLevel;
+        bool                        hasEntry;
+        AtomicValue<int>            locked;
+
+        // set once the node is being erased, and once it is linked on all its levels
+        AtomicValue<int>            marked;
+        AtomicValue<int>            fullyLinked;
+
+        alignas(K) unsigned char    keyStorage[sizeof(K)];
+        alignas(V) unsigned char    valueStorage[sizeof(V)];
+
+        // topLevel entries, allocated with the node
+        AtomicValue<Node*>          next[1];
+    };
+
+    struct Seed
+    {
+        AtomicValue<uint32_t>   value;
+        char                    padding[OPENTHREADS_CACHE_LINE_SIZE - sizeof(uint32_t)];
+    };
+
+    ConcurrentSkipListMap(const ConcurrentSkipListMap&);
+    ConcurrentSkipListMap& operator=(const ConcurrentSkipListMap&);
+
+    static bool isLive(const Node* node)
+    {
+        return node->fullyLinked.load(MEMORY_ORDER_ACQUIRE) && !node->marked.load(MEMORY_ORDER_ACQUIRE);
+    }
+
+    /** Return node or the first node after it in the list that is present.*/
+    static Node* firstLive(Node* node)
+    {
+        while (node && !isLive(node)) node = node->next[0].load(MEMORY_ORDER_ACQUIRE);
+        return node;
+    }
+
+    int randomLevel()
+    {
+        // xorshift, one generator per thread slot, a race between two threads of a slot only costs randomness
+        AtomicValue<uint32_t>& seed = _seeds[GetCurrentThreadSlot() & _seedMask].value;
+        uint32_t x = seed.load(MEMORY_ORDER_RELAXED);
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        seed.store(x, MEMORY_ORDER_RELAXED);
+
+        int level = 1;
+        while (level<MAX_LEVEL && (x & 3)==0)
+        {
+            ++level;
+            x >>= 2;
+        }
+        return level;
+    }
+
+    /**
+     *  Fill preds and succs with the nodes around key on every level.
+     *
+     *  @return  The highest level on which the node of key was found, or -1.
+     */
+    int findNode(const K& key, Node** preds, Node** succs) const
+    {
+        int levelFound = -1;
+        Node* pred = _head;
+        for(int level = MAX_LEVEL - 1; level>=0; --level)
+        {
+            Node* node = pred->next[level].load(MEMORY_ORDER_ACQUIRE);
+            while (node && _less(*node->key(), key))
+            {
+                pred = node;
+                node = pred->next[level].load(MEMORY_ORDER_ACQUIRE);
+            }
+            if (levelFound<0 && node && !_less(key, *node->key())) levelFound = level;
+            preds[level] = pred;
+            succs[level] = node;
+        }
+        return levelFound;
+    }
+
+    /** Return the first node, present or not, whose key is not less than key.*/
+    Node* lowerBoundNode(const K& key) const
+    {
+        Node* pred = _head;
+        Node* node = 0;
+        for(int level = MAX_LEVEL - 1; level>=0; --level)
+        {
+            node = pred->next[level].load(MEMORY_ORDER_ACQUIRE);
+            while (node && _less(*node->key(), key))
+            {
+                pred = node;
+                node = pred->next[level].load(MEMORY_ORDER_ACQUIRE);
+            }
+        }
+        return node;
+    }
+
+    const Node* findLive(const K& key) const
+    {
+        const Node* node = lowerBoundNode(key);
+        return node && !_less(key, *node->key()) && isLive(node) ? node : 0;
+    }
+
+    /**
+     *  Wait for a node lock, or before retrying an insert or erase whose neighbours changed.  The thread we wait for may
+     *  have been preempted half way, so after a few pauses sleep to give it the processor.  Yielding is not enough, it
+     *  hands the processor to any busy thread but not reliably to the preempted one.
+     */
+    static void backoff(unsigned int& attempts)
+    {
+        if (++attempts<SPIN_COUNT) SpinPause();
+        else Thread::microSleep(50);
+    }
+
+    static void lockNode(Node* node)
+    {
+        for(unsigned int attempts = 0; node->locked.exchange(1, MEMORY_ORDER_ACQUIRE);) backoff(attempts);
+    }
+
+    static void unlockNode(Node* node) { node->locked.store(0, MEMORY_ORDER_RELEASE); }
+
+    static void unlockPreds(Node** preds, int highestLocked)
+    {
+        for(int level = 0; level<=highestLocked; ++level)
+        {
+            if (level==0 || preds[level]!=preds[level - 1]) unlockNode(preds[level]);
+        }
+    }
+
+    /**
+     *  Erase the node of key, or only expected if it is not 0.  Inside a read-side section.
+     */
+    bool eraseNode(const K& key, Node* expected)
+    {
+        Node* preds[MAX_LEVEL];
+        Node* succs[MAX_LEVEL];
+        Node* victim = 0;
+        bool isMarked = false;
+        for(unsigned int attempts = 0;; backoff(attempts))
+        {
+            int levelFound = findNode(key, preds, succs);
+            if (!isMarked)
+            {
+                if (levelFound<0) return false;
+
+                victim = succs[levelFound];
+                if (expected && victim!=expected) return false;
+
+                // only erase nodes fully linked, and found on their top level so that preds covers all of them
+                if (!victim->fullyLinked.load(MEMORY_ORDER_ACQUIRE) || victim->topLevel - 1!=levelFound ||
+                    victim->marked.load(MEMORY_ORDER_ACQUIRE))
+                {
+                    return false;
+                }
+
+                lockNode(victim);
+                if (victim->marked.load(MEMORY_ORDER_RELAXED))
+                {
+                    unlockNode(victim);
+                    return false;
+                }
+                victim->marked.store(1, MEMORY_ORDER_RELEASE);
+                isMarked = true;
+            }
+
+            int highestLocked = -1;
+            bool valid = true;
+            for(int level = 0; valid && level<victim->topLevel; ++level)
+            {
+                Node* pred = preds[level];
+                if (level==0 || pred!=preds[level - 1])
+                {
+                    lockNode(pred);
+                }
+                highestLocked = level;
+                valid = !pred->marked.load(MEMORY_ORDER_RELAXED) &&
+                        pred->next[level].load(MEMORY_ORDER_RELAXED)==victim;
+            }
+
+            if (!valid)
+            {
+                unlockPreds(preds, highestLocked);
+                continue;
+            }
+
+            for(int level = victim->topLevel - 1; level>=0; --level)
+            {
+                preds[level]->next[level].store(victim->next[level].load(MEMORY_ORDER_RELAXED), MEMORY_ORDER_RELEASE);
+            }
+
+            unlockNode(victim);
+            unlockPreds(preds, highestLocked);
+
+            _domain.callRcu(&Node::destroyCallback, victim);
+            _size.decrement();
+            return true;
+        }
+    }
+
+    RcuDomain&              _domain;
+    Compare                 _less;
+    Node*                   _head;
+    Seed*                   _seeds;
+    unsigned int            _seedMask;
+    ShardedGauge            _size;
+};
+
+/**
+ *  @class ConcurrentSkipListSet
+ *  @brief  Ordered set on top of ConcurrentSkipListMap, with the same guarantees.
+ */
+template<typename K, typename Compare = std::less<K> >
+class ConcurrentSkipListSet
+{
+public:
+
+    explicit ConcurrentSkipListSet(RcuDomain& domain = RcuDomain::getDefault()) : _map(domain) {}
+
+    /** @return  true if the key was inserted, false if it was present.*/
+    bool insert(const K& key) { return _map.insert(key, Empty()); }
+
+    /** @return  true if the key was present.*/
+    bool erase(const K& key) { return _map.erase(key); }
+
+    bool contains(const K& key) const { return _map.contains(key); }
+
+    bool first(K& key) const { Empty empty; return _map.first(key, empty); }
+
+    bool lowerBound(const K& key, K& foundKey) const { Empty empty; return _map.lowerBound(key, foundKey, empty); }
+
+    bool popFirst(K& key) { Empty empty; return _map.popFirst(key, empty); }
+
+    /** Call visitor(key) for every key in order.  Weakly consistent.*/
+    template<class Visitor>
+    void forEach(Visitor visitor) const { _map.forEach(KeyVisitor<Visitor>(visitor)); }
+
+    /** Call visitor(key) for every key in [from, to), in order.  Weakly consistent.*/
+    template<class Visitor>
+    void forEachInRange(const K& from, const K& to, Visitor visitor) const
+    {
+        _map.forEachInRange(from, to, KeyVisitor<Visitor>(visitor));
+    }
+
+    size_t size() const { return _map.size(); }
+
+    bool empty() const { return _map.empty(); }
+
+private:
+
+    struct Empty {};
+
+    template<class Visitor>
+    struct KeyVisitor
+    {
+        KeyVisitor(Visitor& visitor) : _visitor(visitor) {}
+        void operator() (const K& key, const Empty&) const { _visitor(key); }
+        Visitor& _visitor;
+    };
+
+    ConcurrentSkipListSet(const ConcurrentSkipListSet&);
+    ConcurrentSkipListSet& operator=(const ConcurrentSkipListSet&);
+
+    ConcurrentSkipListMap<K, Empty, Compare> _map;
+};
+
+}
+
+#endif // _OPENTHREADS_CONCURRENTSKIPLISTMAP_
@@ -0,0 +1,356 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// ConcurrentVector - vector that many threads append to, whose elements never move
+// ~~~~~~~~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_CONCURRENTVECTOR_
+#define _OPENTHREADS_CONCURRENTVECTOR_
+
+#include <OpenThreads/AtomicValue.h>
+#include <OpenThreads/CacheAlignedArray.h>
+#include <stddef.h>
+#include <iterator>
+#include <new>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace OpenThreads {
+
+/**
+ *  @class ConcurrentVector
+ *  @brief  Indexed sequence that threads append to concurrently without a lock, for fan-in of results.
+ *
+ *  Storage is a table of segments of exponentially growing sizes: segment 0 holds FIRST_SEGMENT_SIZE elements and
+ *  segment k holds FIRST_SEGMENT_SIZE << k.  Growing adds segments and never copies, so elements keep their address
+ *  for the life of the vector and references to them stay valid while other threads append.
+ *
+ *  push_back() and growBy() reserve their indices with a fetch-and-add on the size, then construct the elements in
+ *  place.  The first thread to need a segment allocates it and installs it with a compare-and-swap, a thread that
+ *  loses the race frees its own.  There is no erase, and shrinking with clear() is not concurrent.
+ *
+ *  size() counts reserved elements, some of which may still be under construction.  An element may be read by the
+ *  thread that appended it, and by other threads once they have synchronised with it, typically by joining the
+ *  workers or waiting on a Barrier or BlockCount.  Within a segment elements are contiguous, forEach() walks a range
+ *  segment by segment, and disjoint ranges can be walked by different threads:
+ *
+ *  @code
+ *  // worker
+ *  results.push_back(compute(item));
+ *
+ *  // after the workers are done, each of numThreads threads takes a share
+ *  size_t n = results.size();
+ *  results.forEach(n * t / numThreads, n * (t + 1) / numThreads, Accumulate(total[t]));
+ *  @endcode
+ *
+ *  The constructors of T used by appends must not throw.
+ */
+template<typename T>
+class ConcurrentVector
+{
+public:
+
+    enum
+    {
+        /** Number of elements of the first segment, each following segment is twice as large as the previous.*/
+        FIRST_SEGMENT_SIZE = 16
+    };
+
+    template<typename V, typename E>
+    class Iterator;
+
+    typedef T                                               value_type;
+    typedef T&                                              reference;
+    typedef const T&                                        const_reference;
+    typedef size_t                                          size_type;
+    typedef Iterator<ConcurrentVector, T>                   iterator;
+    typedef Iterator<const ConcurrentVector, const T>       const_iterator;
+
+    ConcurrentVector() {}
+
+    /**
+     *  Destroy the elements.  No other thread may use the vector.
+     */
+    ~ConcurrentVector()
+    {
+        clear();
+    }
+
+    /**
+     *  Append a copy of value.  Any thread.
+     *
+     *  @return  The index of the new element.
+     */
+    size_t push_back(const T& value)
+    {
+        size_t index = _size.fetch_add(1, MEMORY_ORDER_RELAXED);
+        new (slot(index)) T(value);
+        return index;
+    }
+
+    /**
+     *  Append an element constructed from args.  Any thread.
+     *
+     *  @return  The index of the new element.
+     */
+    template<typename... Args>
+    size_t emplace_back(Args&&... args)
+    {
+        size_t index = _size.fetch_add(1, MEMORY_ORDER_RELAXED);
+        new (slot(index)) T(std::forward<Args>(args)...);
+        return index;
+    }
+
+    /**
+     *  Append count copies of value, with consecutive indices.  Any thread.
+     *
+     *  @return  The index of the first new element.
+     */
+    size_t growBy(size_t count, const T& value = T())
+    {
+        size_t first = _size.fetch_add(count, MEMORY_ORDER_RELAXED);
+        size_t end = first + count;
+        for(size_t index = first; index<end; )
+        {
+            // construct a segment's worth at a time
+            unsigned int k = segmentOf(index);
+            T* segment = getSegment(k);
+            size_t segmentEnd = segmentBase(k + 1);
+            if (segmentEnd>end) segmentEnd = end;
+            for(; index<segmentEnd; ++index) new (&segment[index - segmentBase(k)]) T(value);
+        }
+        return first;
+    }
+
+    /**
+     *  Make room for count elements up front, so that appends up to there find their segment allocated.  Any thread.
+     */
+    void reserve(size_t count)
+    {
+        for(unsigned int k=0; k<MAX_SEGMENTS && segmentBase(k)<count; ++k) getSegment(k);
+    }
+
+    T& operator[](size_t index) { return *element(index); }
+
+    const T& operator[](size_t index) const { return *element(index); }
+
+    /** Return the number of elements appended or being appended.*/
+    size_t size() const { return _size.load(MEMORY_ORDER_ACQUIRE); }
+
+    bool empty() const { return size()==0; }
+
+    /** Return the number of elements the allocated segments hold.*/
+    size_t capacity() const
+    {
+        unsigned int k = 0;
+        while (k<MAX_SEGMENTS && _segments[k].load(MEMORY_ORDER_ACQUIRE)) ++k;
+        return segmentBase(k);
+    }
+
+    /**
+     *  Call f(element) for the elements with indices from begin up to end, in order.  The elements must be
+     *  constructed and visible to the calling thread.
+     */
+    template<typename Function>
+    void forEach(size_t begin, size_t end, Function f)
+    {
+        forEachIn<T>(*this, begin, end, f);
+    }
+
+    template<typename Function>
+    void forEach(size_t begin, size_t end, Function f) const
+    {
+        forEachIn<const T>(*this, begin, end, f);
+    }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, size()); }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    /**
+     *  Destroy the elements and free the segments.  No other thread may use the vector.
+     */
+    void clear()
+    {
+        size_t count = _size.load(MEMORY_ORDER_RELAXED);
+        for(unsigned int k=0; k<MAX_SEGMENTS; ++k)
+        {
+            T* segment = _segments[k].load(MEMORY_ORDER_RELAXED);
+            if (!segment) continue;
+
+            size_t base = segmentBase(k);
+            for(size_t i=base; i<count && i<segmentBase(k + 1); ++i) segment[i - base].~T();
+            DeallocateAligned(segment, alignof(T));
+            _segments[k].store(0, MEMORY_ORDER_RELAXED);
+        }
+        _size.store(0, MEMORY_ORDER_RELAXED);
+    }
+
+    /**
+     *  @class Iterator
+     *  @brief  Random access iterator over a ConcurrentVector, by index.
+     */
+    template<typename V, typename E>
+    class Iterator
+    {
+    public:
+
+        typedef std::random_access_iterator_tag     iterator_category;
+        typedef T                                   value_type;
+        typedef ptrdiff_t                           difference_type;
+        typedef E*                                  pointer;
+        typedef E&                                  reference;
+
+        Iterator() : _vector(0), _index(0) {}
+
+        Iterator(V* vector, size_t index) : _vector(vector), _index(index) {}
+
+        // iterator converts to const_iterator
+        operator Iterator<const ConcurrentVector, const T>() const { return Iterator<const ConcurrentVector, const T>(_vector, _index); }
+
+        E& operator*() const { return (*_vector)[_index]; }
+        E* operator->() const { return &(*_vector)[_index]; }
+        E& operator[](difference_type n) const { return (*_vector)[_index + n]; }
+
+        Iterator& operator++() { ++_index; return *this; }
+        Iterator operator++(int) { Iterator previous(*this); ++_index; return previous; }
+        Iterator& operator--() { --_index; return *this; }
+        Iterator operator--(int) { Iterator previous(*this); --_index; return previous; }
+
+        Iterator& operator+=(difference_type n) { _index += n; return *this; }
+        Iterator& operator-=(difference_type n) { _index -= n; return *this; }
+        Iterator operator+(difference_type n) const { return Iterator(_vector, _index + n); }
+        Iterator operator-(difference_type n) const { return Iterator(_vector, _index - n); }
+
+        // an iterator and a const_iterator compare with each other
+        template<typename V2, typename E2>
+        difference_type operator-(const Iterator<V2, E2>& rhs) const { return static_cast<difference_type>(_index - rhs.getIndex()); }
+
+        template<typename V2, typename E2>
+        bool operator==(const Iterator<V2, E2>& rhs) const { return _index==rhs.getIndex(); }
+        template<typename V2, typename E2>
+        bool operator!=(const Iterator<V2, E2>& rhs) const { return _index!=rhs.getIndex(); }
+        template<typename V2, typename E2>
+        bool operator<(const Iterator<V2, E2>& rhs) const { return _index<rhs.getIndex(); }
+        template<typename V2, typename E2>
+        bool operator>(const Iterator<V2, E2>& rhs) const { return _index>rhs.getIndex(); }
+        template<typename V2, typename E2>
+        bool operator<=(const Iterator<V2, E2>& rhs) const { return _index<=rhs.getIndex(); }
+        template<typename V2, typename E2>
+        bool operator>=(const Iterator<V2, E2>& rhs) const { return _index>=rhs.getIndex(); }
+
+        size_t getIndex() const { return _index; }
+
+    private:
+
+        V*      _vector;
+        size_t  _index;
+    };
+
+private:
+
+    // segments needed to index the whole address space
+    enum
+    {
+        LOG2_FIRST_SEGMENT_SIZE = 4,
+        MAX_SEGMENTS = sizeof(size_t) * 8 - LOG2_FIRST_SEGMENT_SIZE
+    };
+
+    ConcurrentVector(const ConcurrentVector&);
+    ConcurrentVector& operator=(const ConcurrentVector&);
+
+    static unsigned int highestBit(size_t value)
+    {
+#if defined(__GNUC__)
+        return static_cast<unsigned int>(sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(value));
+#elif defined(_MSC_VER) && defined(_WIN64)
+        unsigned long bit;
+        _BitScanReverse64(&bit, value);
+        return bit;
+#elif defined(_MSC_VER)
+        unsigned long bit;
+        _BitScanReverse(&bit, value);
+        return bit;
+#else
+        unsigned int bit = 0;
+        while (value>>=1) ++bit;
+        return bit;
+#endif
+    }
+
+    // segment k starts at index FIRST_SEGMENT_SIZE * (2^k - 1)
+    static unsigned int segmentOf(size_t index) { return highestBit(index + FIRST_SEGMENT_SIZE) - LOG2_FIRST_SEGMENT_SIZE; }
+
+    static size_t segmentBase(unsigned int k) { return (static_cast<size_t>(FIRST_SEGMENT_SIZE) << k) - FIRST_SEGMENT_SIZE; }
+
+    static size_t segmentSize(unsigned int k) { return static_cast<size_t>(FIRST_SEGMENT_SIZE) << k; }
+
+    T* getSegment(unsigned int k)
+    {
+        T* segment = _segments[k].load(MEMORY_ORDER_ACQUIRE);
+        if (segment) return segment;
+
+        T* allocated = static_cast<T*>(AllocateAligned(segmentSize(k) * sizeof(T), alignof(T)));
+        if (_segments[k].compare_exchange_strong(segment, allocated, MEMORY_ORDER_ACQ_REL, MEMORY_ORDER_ACQUIRE))
+        {
+            return allocated;
+        }
+
+        // another thread installed the segment first
+        DeallocateAligned(allocated, alignof(T));
+        return segment;
+    }
+
+    void* slot(size_t index)
+    {
+        unsigned int k = segmentOf(index);
+        return getSegment(k) + (index - segmentBase(k));
+    }
+
+    T* element(size_t index) const
+    {
+        unsigned int k = segmentOf(index);
+        return _segments[k].load(MEMORY_ORDER_ACQUIRE) + (index - segmentBase(k));
+    }
+
+    template<typename E, typename Function>
+    static void forEachIn(const ConcurrentVector& vector, size_t begin, size_t end, Function& f)
+    {
+        while (begin<end)
+        {
+            unsigned int k = segmentOf(begin);
+            E* segment = vector._segments[k].load(MEMORY_ORDER_ACQUIRE);
+            size_t base = segmentBase(k);
+            size_t segmentEnd = base + segmentSize(k);
+            if (segmentEnd>end) segmentEnd = end;
+            for(; begin<segmentEnd; ++begin) f(segment[begin - base]);
+        }
+    }
+
+    AtomicValue<size_t>     _size;
+    char                    _padding0[OPENTHREADS_CACHE_LINE_SIZE];
+
+    AtomicValue<T*>         _segments[MAX_SEGMENTS];
+};
+
+}
+
+#endif // _OPENTHREADS_CONCURRENTVECTOR_
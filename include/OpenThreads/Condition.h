@@ -22,6 +22,7 @@
 
 #include <OpenThreads/Exports.h>
 #include <OpenThreads/Mutex.h>
+#include <stdint.h>
 
 #if !WIN32
 # include <string.h>
@@ -60,6 +61,22 @@ public:
      */
     virtual int wait(Mutex *mutex, unsigned long int ms);
 
+    /**
+     *  Wait on a mutex until an absolute deadline, given in nanoseconds on
+     *  the clock returned by getMonotonicTime().  Retry loops can keep
+     *  waiting for the same deadline without recomputing it.
+     *
+     *  @return 0 if normal, ETIMEDOUT if the deadline passed, errno code otherwise.
+     */
+    virtual int waitUntil(Mutex *mutex, uint64_t deadlineNs);
+
+    /**
+     *  Wait on a mutex for a given amount of time (ns)
+     *
+     *  @return 0 if normal, ETIMEDOUT if the time elapsed, errno code otherwise.
+     */
+    virtual int waitFor(Mutex *mutex, uint64_t ns);
+
     /**
      *  Signal a SINGLE thread to wake if it's waiting.
      *
@@ -74,6 +91,14 @@ public:
      */
     virtual int broadcast();
 
+    /**
+     *  Get the current time of the clock used for timed waits, in
+     *  nanoseconds from an unspecified starting point.  The clock is
+     *  monotonic where the platform supports it, so it is not affected
+     *  by changes to the system time.
+     */
+    static uint64_t getMonotonicTime();
+
 private:
 
     /**
@@ -103,22 +128,15 @@ private:
         #if WIN32
             typedef void* Handle;
         #else
-            struct Handle 
+            struct Handle
             {
-                // Protect critical section
-                pthread_mutex_t lock;
-
-                // Keeps track of waiters
-                pthread_cond_t condition;
+                // Number of waiting threads in the upper 16 bits, number of
+                // pending wake-ups in the lower 16.  Waiters park on it with
+                // FutexWait().
+                int32_t volatile state;
 
                 // Specifies if this is an auto- or manual-reset event
                 bool manual_reset;
-
-                // "True" if signaled
-                bool is_signaled;
-
-                // Number of waiting threads
-                unsigned waiting_threads;
             };
         #endif
         /// @name Construction/Destruction
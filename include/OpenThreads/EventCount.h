@@ -0,0 +1,167 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// EventCount - let threads sleep until a lock-free condition changes
+// ~~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_EVENTCOUNT_
+#define _OPENTHREADS_EVENTCOUNT_
+
+#include <OpenThreads/AtomicFunctions.h>
+#include <OpenThreads/Futex.h>
+#include <OpenThreads/Condition.h>
+
+namespace OpenThreads {
+
+/**
+ *  @class EventCount
+ *  @brief  Parking spot for threads waiting on a condition that is updated without locks, such as a queue not being
+ *          empty.
+ *
+ *  A consumer that found nothing to do announces itself with prepareWait(), checks its condition once more, and then
+ *  either calls cancelWait() when the condition became true or commitWait() to sleep:
+ *
+ *  @code
+ *  while (!queue.tryPop(item))
+ *  {
+ *      EventCount::Key key = eventCount.prepareWait();
+ *      if (queue.tryPop(item)) { eventCount.cancelWait(); break; }
+ *      eventCount.commitWait(key);
+ *  }
+ *  @endcode
+ *
+ *  A producer makes the condition true and then calls notify().  When nobody is waiting, notify() costs a memory
+ *  barrier and one load.  A notify() that happens between prepareWait() and commitWait() is never lost: commitWait()
+ *  returns straight away.  Waiters may wake up spuriously and must re-check their condition.
+ */
+class EventCount
+{
+public:
+
+    /** Token returned by prepareWait(), to be passed on to commitWait().*/
+    typedef int32_t Key;
+
+    EventCount() : _waiters(0), _epoch(0) {}
+
+    /**
+     *  Wake up one waiting thread, if any.
+     */
+    void notify()
+    {
+        // order the caller's update of the condition before reading _waiters
+        AtomicThreadFence();
+        if (_waiters!=0)
+        {
+            AtomicIncrement(_epoch);
+            FutexWake(_epoch, 1);
+        }
+    }
+
+    /**
+     *  Wake up all waiting threads.
+     */
+    void notifyAll()
+    {
+        AtomicThreadFence();
+        if (_waiters!=0)
+        {
+            AtomicIncrement(_epoch);
+            FutexWakeAll(_epoch);
+        }
+    }
+
+    /**
+     *  Announce that the calling thread is about to wait.  The condition must be checked again afterwards.
+     */
+    Key prepareWait()
+    {
+        // full barrier: notifiers either see us, or we see their update
+        AtomicIncrement(_waiters);
+        return _epoch;
+    }
+
+    /**
+     *  Withdraw from waiting, after prepareWait() when the condition turned out to be true.
+     */
+    void cancelWait()
+    {
+        AtomicDecrement(_waiters);
+    }
+
+    /**
+     *  Sleep until notify() or notifyAll() is called after the prepareWait() that returned key.
+     */
+    void commitWait(Key key)
+    {
+        while (_epoch==key) FutexWait(_epoch, key);
+        AtomicDecrement(_waiters);
+    }
+
+    /**
+     *  Sleep until notify() or notifyAll() is called after the prepareWait() that returned key, for at most
+     *  timeoutNs nanoseconds.
+     *
+     *  @return true if notified, false if the timeout expired.
+     */
+    bool commitWait(Key key, uint64_t timeoutNs)
+    {
+        uint64_t deadline = Condition::getMonotonicTime() + timeoutNs;
+        bool notified = true;
+        while (_epoch==key)
+        {
+            uint64_t now = Condition::getMonotonicTime();
+            if (now>=deadline) { notified = false; break; }
+            FutexWait(_epoch, key, deadline - now);
+        }
+        AtomicDecrement(_waiters);
+        return notified;
+    }
+
+    /**
+     *  Block until condition() returns true, with the prepareWait() / commitWait() protocol.
+     */
+    template<class Predicate>
+    void await(Predicate condition)
+    {
+        while (!condition())
+        {
+            Key key = prepareWait();
+            if (condition())
+            {
+                cancelWait();
+                return;
+            }
+            commitWait(key);
+        }
+    }
+
+    /**
+     *  Return the number of threads between prepareWait() and the end of their wait.
+     */
+    int32_t getNumWaiters() const { return _waiters; }
+
+private:
+
+    EventCount(const EventCount&);
+    EventCount& operator=(const EventCount&);
+
+    int32_t volatile _waiters;
+    int32_t volatile _epoch;
+};
+
+}
+
+#endif // _OPENTHREADS_EVENTCOUNT_
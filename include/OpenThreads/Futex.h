@@ -0,0 +1,66 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// Futex - park and wake threads on the value of a 32-bit word
+// ~~~~~
+//
+
+#ifndef _OPENTHREADS_FUTEX_
+#define _OPENTHREADS_FUTEX_
+
+#include <OpenThreads/Exports.h>
+#include <stdint.h>
+
+namespace OpenThreads
+{
+	/// Block the calling thread as long as a 32-bit integer holds an expected value.
+	///
+	/// The check and the sleep are performed atomically with respect to FutexWake(), so a thread changing the value and
+	/// then calling FutexWake() can never be missed.  The function may return spuriously, callers must re-check their
+	/// condition in a loop.  On Linux this maps directly onto the futex system call, other platforms use a hashed table
+	/// of Mutex/Condition pairs.
+	///
+	/// @param[in] rAtomic   Integer to wait on.
+	/// @param[in] expected  Value the integer must hold for the thread to go to sleep.
+	///
+	/// @return  0 when woken up, or when the integer did not hold @c expected.
+	OPENTHREAD_EXPORT_DIRECTIVE int FutexWait( int32_t volatile & rAtomic, int32_t expected );
+
+	/// Block the calling thread as long as a 32-bit integer holds an expected value, for at most a given time.
+	///
+	/// @param[in] rAtomic    Integer to wait on.
+	/// @param[in] expected   Value the integer must hold for the thread to go to sleep.
+	/// @param[in] timeoutNs  Maximum time to sleep, in nanoseconds.
+	///
+	/// @return  0 when woken up, or when the integer did not hold @c expected, ETIMEDOUT if the timeout expired.
+	OPENTHREAD_EXPORT_DIRECTIVE int FutexWait( int32_t volatile & rAtomic, int32_t expected, uint64_t timeoutNs );
+
+	/// Wake up threads blocked in FutexWait() on a 32-bit integer.
+	///
+	/// @param[in] rAtomic  Integer the threads are waiting on.
+	/// @param[in] count    Maximum number of threads to wake up.
+	///
+	/// @return  0 if normal, -1 if errno set.
+	OPENTHREAD_EXPORT_DIRECTIVE int FutexWake( int32_t volatile & rAtomic, int32_t count );
+
+	/// Wake up all threads blocked in FutexWait() on a 32-bit integer.
+	///
+	/// @param[in] rAtomic  Integer the threads are waiting on.
+	///
+	/// @return  0 if normal, -1 if errno set.
+	OPENTHREAD_EXPORT_DIRECTIVE int FutexWakeAll( int32_t volatile & rAtomic );
+}
+
+#endif // _OPENTHREADS_FUTEX_
@@ -0,0 +1,198 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// HazardPointer - safe memory reclamation for lock-free data structures
+// ~~~~~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_HAZARDPOINTER_
+#define _OPENTHREADS_HAZARDPOINTER_
+
+#include <OpenThreads/Exports.h>
+#include <OpenThreads/AtomicFunctions.h>
+#include <OpenThreads/Mutex.h>
+
+namespace OpenThreads {
+
+class HazardPointerThreadState;
+
+/**
+ *  @class HazardPointerDomain
+ *  @brief  Set of hazard pointers, and of the objects waiting to be deleted once no hazard pointer refers to them.
+ *
+ *  A thread that wants to dereference a pointer read from a lock-free structure first publishes it in a
+ *  HazardPointer.  A thread that unlinks an object from the structure hands it to retire() instead of deleting it.
+ *  Retired objects are collected per thread and reclaimed in batches: once a thread has retired about twice as many
+ *  objects as there are hazard pointers, it scans all hazard pointers and deletes the objects none of them protect.
+ *
+ *  Each thread caches the hazard pointer records it used.  When the thread exits, its records are returned to the
+ *  domain and the objects it could not reclaim yet are handed over to the next thread that scans.
+ *
+ *  A domain must outlive every thread that uses it.  Most code should simply use getDefault().
+ */
+class OPENTHREAD_EXPORT_DIRECTIVE HazardPointerDomain
+{
+public:
+
+    typedef void (*Deleter)(void*);
+
+    /** One hazard pointer, owned by one thread at a time, on a cache line of its own.*/
+    struct alignas(OPENTHREADS_CACHE_LINE_SIZE) Record
+    {
+        void* volatile      pointer;
+        int32_t volatile    active;
+        Record*             next;
+    };
+
+    HazardPointerDomain();
+
+    /**
+     *  Delete all objects still waiting for reclamation.  No other thread may use the domain any more.
+     */
+    ~HazardPointerDomain();
+
+    /**
+     *  Get the process wide domain.
+     */
+    static HazardPointerDomain& getDefault();
+
+    /**
+     *  Hand over an object that has been unlinked from a shared structure.  deleter(object) is called once no
+     *  hazard pointer protects the object.
+     */
+    void retire(void* object, Deleter deleter);
+
+    /**
+     *  Hand over an object that has been unlinked from a shared structure, to be deleted with delete once no hazard
+     *  pointer protects it.
+     */
+    template<typename T>
+    void retire(T* object) { retire(object, &deleteObject<T>); }
+
+    /**
+     *  Reclaim the objects retired by the calling thread that are no longer protected, without waiting for the
+     *  batch to fill up.
+     */
+    void reclaim();
+
+    /**
+     *  Get a record for the calling thread.  Used by HazardPointer.
+     */
+    Record* acquireRecord();
+
+    /**
+     *  Give back a record obtained with acquireRecord().  Used by HazardPointer.
+     */
+    void releaseRecord(Record* record);
+
+    /**
+     *  Return the number of records ever allocated, which is the maximum number of hazard pointers in use at once.
+     */
+    int32_t getNumRecords() const { return _numRecords; }
+
+private:
+
+    friend class HazardPointerThreadState;
+
+    template<typename T>
+    static void deleteObject(void* object) { delete static_cast<T*>(object); }
+
+    HazardPointerDomain(const HazardPointerDomain&);
+    HazardPointerDomain& operator=(const HazardPointerDomain&);
+
+    Record* volatile    _records;
+    int32_t volatile    _numRecords;
+
+    // objects left behind by exited threads
+    Mutex               _orphanMutex;
+    void*               _orphans;
+    int32_t volatile    _numOrphans;
+};
+
+/**
+ *  @class HazardPointer
+ *  @brief  Scoped hazard pointer: while it protects an object, retire() will not delete that object.
+ *
+ *  @code
+ *  HazardPointer<Node> hp;
+ *  Node* node = hp.protect(_head);     // safe to dereference until hp is reset or destroyed
+ *  @endcode
+ */
+template<typename T>
+class HazardPointer
+{
+public:
+
+    explicit HazardPointer(HazardPointerDomain& domain = HazardPointerDomain::getDefault()) :
+        _domain(domain),
+        _record(domain.acquireRecord()) {}
+
+    ~HazardPointer()
+    {
+        _domain.releaseRecord(_record);
+    }
+
+    /**
+     *  Read a shared pointer and protect the object it refers to, retrying until the pointer did not change while
+     *  it was being published.
+     */
+    T* protect(T* volatile const & source)
+    {
+        T* pointer = source;
+        while (!tryProtect(pointer, source)) {}
+        return pointer;
+    }
+
+    /**
+     *  Publish pointer, which was read from source, and check that source still holds it.
+     *
+     *  @return true if the object is now protected, otherwise pointer is updated with the new value of source.
+     */
+    bool tryProtect(T*& pointer, T* volatile const & source)
+    {
+        // full barrier: the hazard must be visible before source is read again
+        AtomicExchangePointer(_record->pointer, pointer);
+
+        T* current = source;
+        if (current==pointer) return true;
+
+        pointer = current;
+        return false;
+    }
+
+    /**
+     *  Protect pointer without any validation, for objects known to be alive.
+     */
+    void set(T* pointer) { AtomicExchangePointer(_record->pointer, pointer); }
+
+    /**
+     *  Stop protecting the object.
+     */
+    void reset() { AtomicExchangePointerRelease(_record->pointer, 0); }
+
+    T* get() const { return static_cast<T*>(_record->pointer); }
+
+private:
+
+    HazardPointer(const HazardPointer&);
+    HazardPointer& operator=(const HazardPointer&);
+
+    HazardPointerDomain&            _domain;
+    HazardPointerDomain::Record*    _record;
+};
+
+}
+
+#endif // _OPENTHREADS_HAZARDPOINTER_
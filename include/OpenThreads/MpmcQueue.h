@@ -0,0 +1,408 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// MpmcQueue - bounded multiple producer, multiple consumer queue
+// ~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_MPMCQUEUE_
+#define _OPENTHREADS_MPMCQUEUE_
+
+#include <OpenThreads/AtomicValue.h>
+#include <OpenThreads/CacheAlignedArray.h>
+#include <OpenThreads/EventCount.h>
+#include <stddef.h>
+#include <new>
+
+namespace OpenThreads {
+
+/**
+ *  @class MpmcQueue
+ *  @brief  Fixed capacity FIFO for any number of producer and consumer threads.
+ *
+ *  This is Dmitry Vyukov's bounded queue.  Every cell carries a sequence number that tells whether it is ready to be
+ *  written or read for a given position, so a push or a pop claims its position with a single compare-and-swap and
+ *  producers and consumers only contend among themselves.  pushBulk() and popBulk() claim a whole range of positions
+ *  with one compare-and-swap.
+ *
+ *  tryPush() and tryPop() never wait.  push(), pop(), pushFor() and popFor() spin briefly and then sleep on an
+ *  EventCount until the queue has room or elements.  Every successful operation checks whether a thread sleeps on the
+ *  opposite side, which costs a memory barrier and a load.
+ *
+ *  The copy constructor and the assignment of T must not throw: a position is claimed before the element is copied
+ *  into or out of its cell, and a position that is never published stops the queue.
+ */
+template<typename T>
+class MpmcQueue
+{
+public:
+
+    /**
+     *  Create a queue holding at least capacity elements, rounded up to a power of two, and at least 2.
+     */
+    explicit MpmcQueue(size_t capacity) :
+        _enqueuePosition(0),
+        _dequeuePosition(0),
+        _cells(numCells(capacity))
+    {
+        _mask = _cells.size() - 1;
+        for(size_t i=0; i<=_mask; ++i) _cells[i].sequence.store(i, MEMORY_ORDER_RELAXED);
+    }
+
+    /**
+     *  Destroy the elements still in the queue.  No other thread may use it any more.
+     */
+    ~MpmcQueue()
+    {
+        for(size_t position = _dequeuePosition.load(); position!=_enqueuePosition.load(); ++position)
+        {
+            _cells[position & _mask].value()->~T();
+        }
+    }
+
+    /**
+     *  Append a copy of value if the queue has room.
+     *
+     *  @return  false if the queue is full.
+     */
+    bool tryPush(const T& value)
+    {
+        if (!tryPushImpl(value)) return false;
+        _notEmpty.notify();
+        return true;
+    }
+
+    /**
+     *  Remove the oldest element and assign it to value, if any.
+     *
+     *  @return  false if the queue is empty.
+     */
+    bool tryPop(T& value)
+    {
+        if (!tryPopImpl(value)) return false;
+        _notFull.notify();
+        return true;
+    }
+
+    /**
+     *  Append a copy of value, waiting for room if the queue is full.
+     */
+    void push(const T& value)
+    {
+        waitFor(_notFull, PushOp(*this, value), 0);
+        _notEmpty.notify();
+    }
+
+    /**
+     *  Append a copy of value, waiting at most timeoutNs nanoseconds for room.
+     *
+     *  @return  false if the queue stayed full.
+     */
+    bool pushFor(const T& value, uint64_t timeoutNs)
+    {
+        if (!waitFor(_notFull, PushOp(*this, value), &timeoutNs)) return false;
+        _notEmpty.notify();
+        return true;
+    }
+
+    /**
+     *  Remove the oldest element, waiting for one if the queue is empty.
+     */
+    void pop(T& value)
+    {
+        waitFor(_notEmpty, PopOp(*this, value), 0);
+        _notFull.notify();
+    }
+
+    /**
+     *  Remove the oldest element, waiting at most timeoutNs nanoseconds for one.
+     *
+     *  @return  false if the queue stayed empty.
+     */
+    bool popFor(T& value, uint64_t timeoutNs)
+    {
+        if (!waitFor(_notEmpty, PopOp(*this, value), &timeoutNs)) return false;
+        _notFull.notify();
+        return true;
+    }
+
+    /**
+     *  Append copies of as many of the count elements at values as there is room for, claiming their positions at
+     *  once.  The elements stay in order with respect to each other, but elements of other producers can come
+     *  between them and the elements of other batches.
+     *
+     *  @return  The number of elements appended.
+     */
+    size_t pushBulk(const T* values, size_t count)
+    {
+        if (count==0) return 0;
+
+        size_t position = _enqueuePosition.load(MEMORY_ORDER_RELAXED);
+        size_t claimed;
+        for(;;)
+        {
+            // count the consecutive cells ready for writing
+            claimed = 0;
+            while (claimed<count && cellAt(position + claimed).sequence.load(MEMORY_ORDER_ACQUIRE)==position + claimed)
+            {
+                ++claimed;
+            }
+            if (claimed==0)
+            {
+                ptrdiff_t difference = static_cast<ptrdiff_t>(cellAt(position).sequence.load(MEMORY_ORDER_ACQUIRE) - position);
+
+                // the first cell still holds the element of the previous lap
+                if (difference<0) return 0;
+
+                // another thread took the first cell since we loaded the position
+                position = _enqueuePosition.load(MEMORY_ORDER_RELAXED);
+                continue;
+            }
+
+            if (_enqueuePosition.compare_exchange_weak(position, position + claimed, MEMORY_ORDER_RELAXED)) break;
+        }
+
+        for(size_t i=0; i<claimed; ++i)
+        {
+            Cell& cell = cellAt(position + i);
+            new (cell.value()) T(values[i]);
+            cell.sequence.store(position + i + 1, MEMORY_ORDER_RELEASE);
+        }
+
+        if (claimed==1) _notEmpty.notify();
+        else _notEmpty.notifyAll();
+        return claimed;
+    }
+
+    /**
+     *  Remove up to maxCount of the oldest elements, claiming their positions at once and assigning them to
+     *  values[0], values[1]...
+     *
+     *  @return  The number of elements removed.
+     */
+    size_t popBulk(T* values, size_t maxCount)
+    {
+        if (maxCount==0) return 0;
+
+        size_t position = _dequeuePosition.load(MEMORY_ORDER_RELAXED);
+        size_t claimed;
+        for(;;)
+        {
+            // count the consecutive cells ready for reading
+            claimed = 0;
+            while (claimed<maxCount && cellAt(position + claimed).sequence.load(MEMORY_ORDER_ACQUIRE)==position + claimed + 1)
+            {
+                ++claimed;
+            }
+            if (claimed==0)
+            {
+                ptrdiff_t difference = static_cast<ptrdiff_t>(cellAt(position).sequence.load(MEMORY_ORDER_ACQUIRE) - (position + 1));
+
+                // the first cell has not been written for this lap yet
+                if (difference<0) return 0;
+
+                // another thread took the first cell since we loaded the position
+                position = _dequeuePosition.load(MEMORY_ORDER_RELAXED);
+                continue;
+            }
+
+            if (_dequeuePosition.compare_exchange_weak(position, position + claimed, MEMORY_ORDER_RELAXED)) break;
+        }
+
+        for(size_t i=0; i<claimed; ++i)
+        {
+            Cell& cell = cellAt(position + i);
+            T* slot = cell.value();
+            values[i] = *slot;
+            slot->~T();
+            cell.sequence.store(position + i + _mask + 1, MEMORY_ORDER_RELEASE);
+        }
+
+        if (claimed==1) _notFull.notify();
+        else _notFull.notifyAll();
+        return claimed;
+    }
+
+    /** Return the number of elements in the queue, only a hint while other threads use it.*/
+    size_t size() const
+    {
+        size_t dequeuePosition = _dequeuePosition.load(MEMORY_ORDER_ACQUIRE);
+        size_t enqueuePosition = _enqueuePosition.load(MEMORY_ORDER_ACQUIRE);
+        return enqueuePosition>dequeuePosition ? enqueuePosition - dequeuePosition : 0;
+    }
+
+    bool empty() const { return size()==0; }
+
+    size_t getCapacity() const { return _mask + 1; }
+
+private:
+
+    // waits spin for this many pauses before they sleep
+    enum { SPIN_COUNT = 1000 };
+
+    struct Cell
+    {
+        AtomicValue<size_t> sequence;
+
+        // raw storage, the value only exists while the cell is full
+        alignas(T) unsigned char    storage[sizeof(T)];
+
+        T* value() { return reinterpret_cast<T*>(storage); }
+    };
+
+    struct PushOp
+    {
+        PushOp(MpmcQueue& queue, const T& value) : _queue(queue), _value(value) {}
+        bool operator() () const { return _queue.tryPushImpl(_value); }
+        MpmcQueue& _queue;
+        const T& _value;
+    };
+
+    struct PopOp
+    {
+        PopOp(MpmcQueue& queue, T& value) : _queue(queue), _value(value) {}
+        bool operator() () const { return _queue.tryPopImpl(_value); }
+        MpmcQueue& _queue;
+        T& _value;
+    };
+
+    MpmcQueue(const MpmcQueue&);
+    MpmcQueue& operator=(const MpmcQueue&);
+
+    static size_t numCells(size_t capacity)
+    {
+        size_t size = 2;
+        while (size<capacity) size <<= 1;
+        return size;
+    }
+
+    Cell& cellAt(size_t position) { return _cells[position & _mask]; }
+
+    bool tryPushImpl(const T& value)
+    {
+        size_t position = _enqueuePosition.load(MEMORY_ORDER_RELAXED);
+        for(;;)
+        {
+            Cell& cell = cellAt(position);
+            size_t sequence = cell.sequence.load(MEMORY_ORDER_ACQUIRE);
+            ptrdiff_t difference = static_cast<ptrdiff_t>(sequence - position);
+            if (difference==0)
+            {
+                if (_enqueuePosition.compare_exchange_weak(position, position + 1, MEMORY_ORDER_RELAXED))
+                {
+                    new (cell.value()) T(value);
+                    cell.sequence.store(position + 1, MEMORY_ORDER_RELEASE);
+                    return true;
+                }
+            }
+            else if (difference<0)
+            {
+                // the cell still holds the element of the previous lap
+                return false;
+            }
+            else
+            {
+                position = _enqueuePosition.load(MEMORY_ORDER_RELAXED);
+            }
+        }
+    }
+
+    bool tryPopImpl(T& value)
+    {
+        size_t position = _dequeuePosition.load(MEMORY_ORDER_RELAXED);
+        for(;;)
+        {
+            Cell& cell = cellAt(position);
+            size_t sequence = cell.sequence.load(MEMORY_ORDER_ACQUIRE);
+            ptrdiff_t difference = static_cast<ptrdiff_t>(sequence - (position + 1));
+            if (difference==0)
+            {
+                if (_dequeuePosition.compare_exchange_weak(position, position + 1, MEMORY_ORDER_RELAXED))
+                {
+                    T* slot = cell.value();
+                    value = *slot;
+                    slot->~T();
+                    cell.sequence.store(position + _mask + 1, MEMORY_ORDER_RELEASE);
+                    return true;
+                }
+            }
+            else if (difference<0)
+            {
+                // the cell has not been written for this lap yet
+                return false;
+            }
+            else
+            {
+                position = _dequeuePosition.load(MEMORY_ORDER_RELAXED);
+            }
+        }
+    }
+
+    /**
+     *  Run operation until it succeeds, spinning first and then sleeping on eventCount.  Without timeoutNs, waits
+     *  forever.
+     */
+    template<class Operation>
+    bool waitFor(EventCount& eventCount, const Operation& operation, const uint64_t* timeoutNs)
+    {
+        for(unsigned int spins = 0; spins<SPIN_COUNT; ++spins)
+        {
+            if (operation()) return true;
+            SpinPause();
+        }
+
+        uint64_t deadline = timeoutNs ? Condition::getMonotonicTime() + *timeoutNs : 0;
+        for(;;)
+        {
+            EventCount::Key key = eventCount.prepareWait();
+            if (operation())
+            {
+                eventCount.cancelWait();
+                return true;
+            }
+
+            if (!timeoutNs)
+            {
+                eventCount.commitWait(key);
+                continue;
+            }
+
+            uint64_t now = Condition::getMonotonicTime();
+            if (now>=deadline)
+            {
+                eventCount.cancelWait();
+                return false;
+            }
+            eventCount.commitWait(key, deadline - now);
+        }
+    }
+
+    char                    _padding0[OPENTHREADS_CACHE_LINE_SIZE];
+    AtomicValue<size_t>     _enqueuePosition;
+    char                    _padding1[OPENTHREADS_CACHE_LINE_SIZE];
+    AtomicValue<size_t>     _dequeuePosition;
+    char                    _padding2[OPENTHREADS_CACHE_LINE_SIZE];
+
+    // read-only after construction
+    size_t                  _mask;
+    CacheAlignedArray<Cell> _cells;
+
+    EventCount              _notEmpty;
+    EventCount              _notFull;
+};
+
+}
+
+#endif // _OPENTHREADS_MPMCQUEUE_
@@ -0,0 +1,256 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// MpscQueue - unbounded intrusive multiple producer, single consumer queue
+// ~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_MPSCQUEUE_
+#define _OPENTHREADS_MPSCQUEUE_
+
+#include <OpenThreads/AtomicFunctions.h>
+#include <OpenThreads/EventCount.h>
+
+namespace OpenThreads {
+
+/**
+ *  @class MpscQueueNode
+ *  @brief  Hook that makes an object queueable in an MpscQueue.  Derive from it, an object can be in at most one
+ *          queue at a time.
+ */
+struct MpscQueueNode
+{
+    MpscQueueNode() : _next(0) {}
+
+    MpscQueueNode* volatile _next;
+};
+
+/**
+ *  @class MpscQueue
+ *  @brief  Unbounded FIFO of objects deriving from MpscQueueNode, filled by any number of threads and emptied by a
+ *          single consumer thread.
+ *
+ *  This is Dmitry Vyukov's intrusive queue.  push() is wait-free: a single atomic exchange of the head pointer, and a
+ *  store that links the previous node to the new one.  pop() never performs an atomic read-modify-write in the
+ *  common case.  The queue does not allocate and does not own its nodes.
+ *
+ *  Between a producer's exchange and its link store the queue is briefly cut in two, pop() then reports the queue as
+ *  empty although it is not.  The node becomes visible once that producer's push() has returned, a consumer that waits
+ *  for a signal sent after push() (see BlockingMpscQueue) never misses it.
+ */
+template<typename T>
+class MpscQueue
+{
+public:
+
+    MpscQueue() :
+        _head(&_stub),
+        _tail(&_stub) {}
+
+    /**
+     *  Append node.  Any thread, full memory barriers.
+     */
+    void push(T* node)
+    {
+        pushNode(static_cast<MpscQueueNode*>(node));
+    }
+
+    /**
+     *  Remove the oldest node.  Consumer only.
+     *
+     *  @return  The node, or 0 if the queue is empty or a push is in progress.
+     */
+    T* pop()
+    {
+        MpscQueueNode* tail = _tail;
+        MpscQueueNode* next = loadNext(tail);
+
+        if (tail==&_stub)
+        {
+            if (!next) return 0;
+
+            // skip the stub
+            _tail = next;
+            tail = next;
+            next = loadNext(next);
+        }
+
+        if (next)
+        {
+            _tail = next;
+            return static_cast<T*>(tail);
+        }
+
+        // tail is the last linked node, unless a producer is between its exchange and its link
+        if (tail!=_head) return 0;
+
+        // put the stub back behind tail so that tail can be handed out
+        pushNode(&_stub);
+
+        next = loadNext(tail);
+        if (next)
+        {
+            _tail = next;
+            return static_cast<T*>(tail);
+        }
+        return 0;
+    }
+
+    /**
+     *  Return true if the queue holds no node.  Consumer only.
+     */
+    bool empty() const
+    {
+        return _tail==&_stub && loadNext(_tail)==0;
+    }
+
+private:
+
+    MpscQueue(const MpscQueue&);
+    MpscQueue& operator=(const MpscQueue&);
+
+    static MpscQueueNode* loadNext(const MpscQueueNode* node)
+    {
+        MpscQueueNode* next = node->_next;
+        AtomicThreadFenceAcquire();
+        return next;
+    }
+
+    void pushNode(MpscQueueNode* node)
+    {
+        node->_next = 0;
+
+        // full barrier: the node's contents are visible before it is linked
+        MpscQueueNode* previous = AtomicExchange(_head, node);
+        previous->_next = node;
+    }
+
+    char                        _padding0[OPENTHREADS_CACHE_LINE_SIZE];
+
+    // producers
+    MpscQueueNode* volatile     _head;
+    char                        _padding1[OPENTHREADS_CACHE_LINE_SIZE];
+
+    // consumer
+    MpscQueueNode*              _tail;
+    MpscQueueNode               _stub;
+};
+
+/**
+ *  @class BlockingMpscQueue
+ *  @brief  MpscQueue whose consumer can wait for a node to arrive.
+ *
+ *  The consumer spins briefly and then sleeps on an EventCount.  A push() costs one more memory barrier and one load
+ *  to find out whether the consumer sleeps.
+ */
+template<typename T>
+class BlockingMpscQueue
+{
+public:
+
+    BlockingMpscQueue() {}
+
+    /**
+     *  Append node and wake the consumer if it waits.  Any thread.
+     */
+    void push(T* node)
+    {
+        _queue.push(node);
+        _notEmpty.notify();
+    }
+
+    /**
+     *  Remove the oldest node without waiting.  Consumer only.
+     *
+     *  @return  The node, or 0 if the queue is empty.
+     */
+    T* tryPop() { return _queue.pop(); }
+
+    /**
+     *  Remove the oldest node, waiting for one if the queue is empty.  Consumer only.
+     */
+    T* pop()
+    {
+        T* node = _queue.pop();
+        for(unsigned int spins = 0; !node; ++spins)
+        {
+            if (spins<SPIN_COUNT)
+            {
+                SpinPause();
+                node = _queue.pop();
+                continue;
+            }
+
+            EventCount::Key key = _notEmpty.prepareWait();
+            node = _queue.pop();
+            if (node)
+            {
+                _notEmpty.cancelWait();
+                break;
+            }
+            _notEmpty.commitWait(key);
+            node = _queue.pop();
+        }
+        return node;
+    }
+
+    /**
+     *  Remove the oldest node, waiting at most timeoutNs nanoseconds for one.  Consumer only.
+     *
+     *  @return  The node, or 0 if the queue stayed empty.
+     */
+    T* popFor(uint64_t timeoutNs)
+    {
+        T* node = _queue.pop();
+        if (node) return node;
+
+        uint64_t deadline = Condition::getMonotonicTime() + timeoutNs;
+        for(;;)
+        {
+            EventCount::Key key = _notEmpty.prepareWait();
+            node = _queue.pop();
+            if (node)
+            {
+                _notEmpty.cancelWait();
+                return node;
+            }
+
+            uint64_t now = Condition::getMonotonicTime();
+            if (now>=deadline)
+            {
+                _notEmpty.cancelWait();
+                return 0;
+            }
+            _notEmpty.commitWait(key, deadline - now);
+        }
+    }
+
+    bool empty() const { return _queue.empty(); }
+
+private:
+
+    // handoffs between running threads take well under this many pauses
+    enum { SPIN_COUNT = 1000 };
+
+    BlockingMpscQueue(const BlockingMpscQueue&);
+    BlockingMpscQueue& operator=(const BlockingMpscQueue&);
+
+    MpscQueue<T>    _queue;
+    EventCount      _notEmpty;
+};
+
+}
+
+#endif // _OPENTHREADS_MPSCQUEUE_
@@ -0,0 +1,283 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// ObjectPool - recycle the storage of objects created and destroyed at a high rate
+// ~~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_OBJECTPOOL_
+#define _OPENTHREADS_OBJECTPOOL_
+
+#include <OpenThreads/AtomicValue.h>
+#include <OpenThreads/CacheAlignedArray.h>
+#include <OpenThreads/Mutex.h>
+#include <OpenThreads/ScopedLock.h>
+#include <OpenThreads/TaggedPtr.h>
+#include <OpenThreads/Thread.h>
+#include <stddef.h>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace OpenThreads {
+
+/**
+ *  @class ObjectPool
+ *  @brief  Allocator for objects of one type, such as tasks or messages, that keeps the storage of destroyed objects
+ *          for the next ones.
+ *
+ *  This is Bonwick's magazine allocator.  Each thread slot, picked with GetCurrentThreadSlot(), caches free storage
+ *  in two magazines of MAGAZINE_SIZE entries, so that most create() and destroy() calls only touch memory of the
+ *  calling thread.  When the magazines of a slot run full or empty, a whole magazine is exchanged with a depot of full
+ *  and empty magazines, two lock-free stacks on TaggedPtr.  An object destroyed by another thread than the one that
+ *  created it thus travels back through the depot.
+ *
+ *  Once the pool holds as much storage as the largest number of objects alive at once, create() and destroy() make
+ *  no calls to the allocator any more.  reserve() gets there from the start.  Storage is only given back to the
+ *  allocator by the destructor.
+ *
+ *  Every object must be destroyed, with destroy(), before the pool.
+ */
+template<typename T>
+class ObjectPool
+{
+public:
+
+    /** Number of free objects a magazine holds.*/
+    enum { MAGAZINE_SIZE = 32 };
+
+    /**
+     *  Create the pool with numSlots thread slots, rounded up to a power of two.  By default there are four slots per
+     *  processor, threads whose slots collide share a pair of magazines.
+     */
+    explicit ObjectPool(unsigned int numSlots = 0) :
+        _slots(RoundUpToPowerOfTwo(numSlots ? numSlots : 4 * static_cast<unsigned int>(GetNumberOfProcessors())))
+    {
+        _slotMask = static_cast<unsigned int>(_slots.size()) - 1;
+        for(unsigned int i=0; i<=_slotMask; ++i)
+        {
+            _slots[i].loaded = newMagazine();
+            _slots[i].previous = newMagazine();
+        }
+    }
+
+    /**
+     *  Give all the storage back to the allocator.  No objects may be alive and no other thread may use the pool.
+     */
+    ~ObjectPool()
+    {
+        for(typename std::vector<Magazine*>::iterator itr = _magazines.begin(); itr!=_magazines.end(); ++itr)
+        {
+            Magazine* magazine = *itr;
+            for(unsigned int i=0; i<magazine->count; ++i) DeallocateAligned(magazine->objects[i], alignof(T));
+            delete magazine;
+        }
+    }
+
+    /**
+     *  Construct an object, with args passed on to the constructor of T, in recycled storage if there is any.
+     */
+    template<typename... Args>
+    T* create(Args&&... args)
+    {
+        void* storage = allocate();
+        try
+        {
+            return new (storage) T(std::forward<Args>(args)...);
+        }
+        catch(...)
+        {
+            deallocate(storage);
+            throw;
+        }
+    }
+
+    /**
+     *  Destroy object, created by this pool, and keep its storage.  Any thread.
+     */
+    void destroy(T* object)
+    {
+        if (!object) return;
+        object->~T();
+        deallocate(object);
+    }
+
+    /**
+     *  Allocate storage for count more objects up front, into the depot.
+     */
+    void reserve(size_t count)
+    {
+        while (count>0)
+        {
+            Magazine* magazine = popMagazine(_emptyMagazines);
+            if (!magazine) magazine = newMagazine();
+
+            while (magazine->count<MAGAZINE_SIZE && count>0)
+            {
+                magazine->objects[magazine->count++] = newStorage();
+                --count;
+            }
+            pushMagazine(_fullMagazines, magazine);
+        }
+    }
+
+    /**
+     *  Return the number of times the pool called the allocator for object storage, to check that a steady state
+     *  makes none.
+     */
+    uint64_t getNumAllocations() const { return _numAllocations.load(MEMORY_ORDER_RELAXED); }
+
+private:
+
+    // a slot lock is held for a few instructions, spin this many pauses before sleeping, in case its holder was
+    // preempted: yielding to it is not enough when other threads are runnable
+    enum { SPIN_COUNT = 100 };
+
+    struct Magazine
+    {
+        Magazine() : count(0) {}
+
+        AtomicValue<Magazine*>  next;       // link in the depot
+        unsigned int            count;
+        void*                   objects[MAGAZINE_SIZE];
+    };
+
+    struct SlotData
+    {
+        AtomicValue<int32_t>    locked;
+        Magazine*               loaded;
+        Magazine*               previous;
+    };
+
+    struct Slot : public SlotData
+    {
+        char padding[OPENTHREADS_CACHE_LINE_SIZE - sizeof(SlotData) % OPENTHREADS_CACHE_LINE_SIZE];
+    };
+
+    ObjectPool(const ObjectPool&);
+    ObjectPool& operator=(const ObjectPool&);
+
+    Slot& lockSlot()
+    {
+        Slot& slot = _slots[GetCurrentThreadSlot() & _slotMask];
+        for(unsigned int spins = 0; slot.locked.exchange(1, MEMORY_ORDER_ACQUIRE); ++spins)
+        {
+            if (spins<SPIN_COUNT) SpinPause();
+            else Thread::microSleep(50);
+        }
+        return slot;
+    }
+
+    static void unlockSlot(Slot& slot) { slot.locked.store(0, MEMORY_ORDER_RELEASE); }
+
+    void* allocate()
+    {
+        void* storage = 0;
+        Slot& slot = lockSlot();
+        if (slot.loaded->count==0)
+        {
+            if (slot.previous->count>0)
+            {
+                std::swap(slot.loaded, slot.previous);
+            }
+            else if (Magazine* full = popMagazine(_fullMagazines))
+            {
+                pushMagazine(_emptyMagazines, slot.previous);
+                slot.previous = slot.loaded;
+                slot.loaded = full;
+            }
+        }
+        if (slot.loaded->count>0) storage = slot.loaded->objects[--slot.loaded->count];
+        unlockSlot(slot);
+
+        return storage ? storage : newStorage();
+    }
+
+    void deallocate(void* storage)
+    {
+        Slot& slot = lockSlot();
+        if (slot.loaded->count==MAGAZINE_SIZE)
+        {
+            if (slot.previous->count<MAGAZINE_SIZE)
+            {
+                std::swap(slot.loaded, slot.previous);
+            }
+            else
+            {
+                Magazine* empty = popMagazine(_emptyMagazines);
+                if (!empty) empty = newMagazine();
+                pushMagazine(_fullMagazines, slot.previous);
+                slot.previous = slot.loaded;
+                slot.loaded = empty;
+            }
+        }
+        slot.loaded->objects[slot.loaded->count++] = storage;
+        unlockSlot(slot);
+    }
+
+    void* newStorage()
+    {
+        _numAllocations.fetch_add(1, MEMORY_ORDER_RELAXED);
+        return AllocateAligned(sizeof(T), alignof(T));
+    }
+
+    Magazine* newMagazine()
+    {
+        Magazine* magazine = new Magazine;
+        ScopedLock<Mutex> lock(_magazinesMutex);
+        _magazines.push_back(magazine);
+        return magazine;
+    }
+
+    // Magazines are only deleted with the pool, so a pop may read the link of a magazine that another thread has
+    // just taken, the tag of the stack makes its compare-and-swap fail.
+
+    static void pushMagazine(TaggedPtr<Magazine>& stack, Magazine* magazine)
+    {
+        typename TaggedPtr<Magazine>::Value head = stack.load();
+        do
+        {
+            magazine->next.store(head.pointer, MEMORY_ORDER_RELAXED);
+        }
+        while (!stack.compareExchange(head, magazine));
+    }
+
+    static Magazine* popMagazine(TaggedPtr<Magazine>& stack)
+    {
+        typename TaggedPtr<Magazine>::Value head = stack.load();
+        while (head.pointer)
+        {
+            if (stack.compareExchange(head, head.pointer->next.load(MEMORY_ORDER_RELAXED))) return head.pointer;
+        }
+        return 0;
+    }
+
+    unsigned int            _slotMask;
+    CacheAlignedArray<Slot> _slots;
+
+    // depot
+    TaggedPtr<Magazine>     _fullMagazines;
+    TaggedPtr<Magazine>     _emptyMagazines;
+
+    // every magazine, for the destructor
+    Mutex                   _magazinesMutex;
+    std::vector<Magazine*>  _magazines;
+
+    AtomicValue<uint64_t>   _numAllocations;
+};
+
+}
+
+#endif // _OPENTHREADS_OBJECTPOOL_
@@ -0,0 +1,150 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// Rcu - epoch based read-copy-update
+// ~~~
+//
+
+#ifndef _OPENTHREADS_RCU_
+#define _OPENTHREADS_RCU_
+
+#include <OpenThreads/Exports.h>
+#include <OpenThreads/AtomicFunctions.h>
+#include <OpenThreads/Mutex.h>
+
+namespace OpenThreads {
+
+class RcuThreadState;
+
+/**
+ *  @class RcuDomain
+ *  @brief  Read-copy-update for read-mostly shared data.
+ *
+ *  Readers bracket their accesses with readLock() and readUnlock().  Entering and leaving a read-side section stores
+ *  the current epoch in a slot owned by the calling thread and issues a memory barrier, readers never perform an
+ *  atomic read-modify-write and never wait.
+ *
+ *  Writers publish a new version of the data with an atomic pointer store (AtomicPtr::assign(),
+ *  AtomicExchangePointer()) and then either call synchronize(), which returns once every reader that might still see
+ *  the old version has left its read-side section, or hand the old version to callRcu()/retire(), which free it in
+ *  batches from a background thread.
+ *
+ *  Read-side sections can be nested.  synchronize() must not be called from inside one, it would wait for itself.
+ *  A domain must outlive every thread that uses it.  Most code should simply use getDefault().
+ */
+class OPENTHREAD_EXPORT_DIRECTIVE RcuDomain
+{
+public:
+
+    typedef void (*Callback)(void*);
+
+    /** Epoch slot of one thread, on a cache line of its own.*/
+    struct alignas(OPENTHREADS_CACHE_LINE_SIZE) Record
+    {
+        int32_t volatile    epoch;      // 0 outside read-side sections
+        int32_t volatile    active;
+        unsigned int        nesting;    // only touched by the owning thread
+        Record*             next;
+    };
+
+    RcuDomain();
+
+    /**
+     *  Stop the callback thread and run the callbacks still pending.  No other thread may use the domain any more.
+     */
+    ~RcuDomain();
+
+    /**
+     *  Get the process wide domain.
+     */
+    static RcuDomain& getDefault();
+
+    /**
+     *  Enter a read-side section.
+     */
+    void readLock();
+
+    /**
+     *  Leave a read-side section.
+     */
+    void readUnlock();
+
+    /**
+     *  Wait until all read-side sections that were active when synchronize() was called have been left.
+     */
+    void synchronize();
+
+    /**
+     *  Call callback(data) from the callback thread once all read-side sections active now have been left.
+     *  Callbacks are processed in batches, a single grace period covers all the callbacks queued meanwhile.
+     */
+    void callRcu(Callback callback, void* data);
+
+    /**
+     *  Delete object, with delete, once all read-side sections active now have been left.
+     */
+    template<typename T>
+    void retire(T* object) { callRcu(&deleteObject<T>, object); }
+
+    /**
+     *  Wait until all callbacks queued so far with callRcu() have run.
+     */
+    void barrier();
+
+private:
+
+    friend class RcuThreadState;
+    friend class RcuCallbackThread;
+
+    template<typename T>
+    static void deleteObject(void* object) { delete static_cast<T*>(object); }
+
+    Record* getRecord();
+    void processCallbacks();
+
+    RcuDomain(const RcuDomain&);
+    RcuDomain& operator=(const RcuDomain&);
+
+    Record* volatile    _records;
+    int32_t volatile    _epoch;
+    Mutex               _synchronizeMutex;
+
+    // callback queue and thread, see Rcu.cpp
+    void*               _callbacks;
+};
+
+/**
+ *  @class ScopedRcuReadLock
+ *  @brief  Read-side section of an RcuDomain for the lifetime of the object.
+ */
+class ScopedRcuReadLock
+{
+public:
+
+    explicit ScopedRcuReadLock(RcuDomain& domain = RcuDomain::getDefault()) : _domain(domain) { _domain.readLock(); }
+
+    ~ScopedRcuReadLock() { _domain.readUnlock(); }
+
+private:
+
+    ScopedRcuReadLock(const ScopedRcuReadLock&);
+    ScopedRcuReadLock& operator=(const ScopedRcuReadLock&);
+
+    RcuDomain& _domain;
+};
+
+}
+
+#endif // _OPENTHREADS_RCU_
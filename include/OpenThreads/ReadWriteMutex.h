@@ -16,54 +16,143 @@
 
 #include <OpenThreads/Thread.h>
 #include <OpenThreads/ReentrantMutex.h>
+#include <OpenThreads/AtomicFunctions.h>
+#include <OpenThreads/Futex.h>
+#include <assert.h>
 
 namespace OpenThreads {
 
+/** ReadWriteMutex allows many concurrent readers or a single writer.
+  *
+  * The whole lock state lives in one 32-bit word, so an uncontended readLock()/readUnlock()
+  * pair is two atomic operations and never touches a mutex.  Threads that have to wait are
+  * parked on the word with FutexWait().
+  *
+  * The lock prefers writers: once a writer is waiting, new readers are held back until it
+  * has been through, so a steady stream of readers can no longer starve writers.  As a
+  * consequence read locks must not be taken recursively.
+  *
+  * An upgrade lock is a read lock that can later be turned into a write lock without
+  * letting another writer in between.  Only one upgrade lock can be held at a time, it
+  * coexists with plain readers.
+  */
 class ReadWriteMutex
 {
     public:
 
         ReadWriteMutex():
-            _readCount(0) {}
+            _state(0) {}
 
         virtual ~ReadWriteMutex() {}
 
         virtual int readLock()
         {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_readCountMutex);
-            int result = 0;
-            if (_readCount==0)
+            for(;;)
             {
-                result = _readWriteMutex.lock();
+                int32_t state = _state;
+                if ((state & (WRITER | WRITER_PENDING_MASK))==0)
+                {
+                    assert((state & READER_MASK)!=READER_MASK && "ReadWriteMutex: too many readers");
+                    if (AtomicCompareExchangeAcquire(_state, state + READER, state)==state) return 0;
+                }
+                else
+                {
+                    park(state);
+                }
             }
-            ++_readCount;
-            return result;
         }
 
 
         virtual int readUnlock()
         {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_readCountMutex);
-            int result = 0;
-            if (_readCount>0)
+            int32_t state = _state;
+            for(;;)
             {
-                --_readCount;
-                if (_readCount==0)
+                // an unmatched readUnlock() would borrow from the other fields, ignore it
+                if ((state & READER_MASK)==0)
                 {
-                    result = _readWriteMutex.unlock();
+                    assert(!"ReadWriteMutex::readUnlock() without a read lock");
+                    return 0;
                 }
+
+                int32_t previous = AtomicCompareExchangeRelease(_state, state - READER, state);
+                if (previous==state) break;
+                state = previous;
             }
-            return result;
+
+            if (((state - READER) & (READER_MASK | PARKED))==PARKED)
+            {
+                wakeParked();
+            }
+            return 0;
         }
 
         virtual int writeLock()
         {
-            return _readWriteMutex.lock();
+            addPendingWriter();
+            for(;;)
+            {
+                int32_t state = _state;
+                if ((state & (READER_MASK | WRITER | UPGRADER))==0)
+                {
+                    if (AtomicCompareExchangeAcquire(_state, state - WRITER_PENDING + WRITER, state)==state) return 0;
+                }
+                else
+                {
+                    park(state);
+                }
+            }
         }
 
         virtual int writeUnlock()
         {
-            return _readWriteMutex.unlock();
+            int32_t state = AtomicAndRelease(_state, ~(WRITER | PARKED));
+            if (state & PARKED) FutexWakeAll(_state);
+            return 0;
+        }
+
+        /** Take a read lock that can be upgraded with upgradeToWriteLock().*/
+        virtual int upgradeLock()
+        {
+            for(;;)
+            {
+                int32_t state = _state;
+                if ((state & (WRITER | WRITER_PENDING_MASK | UPGRADER))==0)
+                {
+                    if (AtomicCompareExchangeAcquire(_state, state | UPGRADER, state)==state) return 0;
+                }
+                else
+                {
+                    park(state);
+                }
+            }
+        }
+
+        /** Release an upgrade lock that has not been upgraded.*/
+        virtual int upgradeUnlock()
+        {
+            int32_t state = AtomicAndRelease(_state, ~(UPGRADER | PARKED));
+            if (state & PARKED) FutexWakeAll(_state);
+            return 0;
+        }
+
+        /** Turn the upgrade lock held by the calling thread into a write lock, waiting for the
+          * current readers to leave.  Release it with writeUnlock().*/
+        virtual int upgradeToWriteLock()
+        {
+            addPendingWriter();
+            for(;;)
+            {
+                int32_t state = _state;
+                if ((state & READER_MASK)==0)
+                {
+                    if (AtomicCompareExchangeAcquire(_state, (state - WRITER_PENDING - UPGRADER) | WRITER, state)==state) return 0;
+                }
+                else
+                {
+                    park(state);
+                }
+            }
         }
 
     protected:
@@ -71,14 +160,45 @@ class ReadWriteMutex
         ReadWriteMutex(const ReadWriteMutex&) {}
         ReadWriteMutex& operator = (const ReadWriteMutex&) { return *(this); }
 
-#if 0
-        ReentrantMutex  _readWriteMutex;
-        ReentrantMutex  _readCountMutex;
-#else
-        OpenThreads::Mutex  _readWriteMutex;
-        OpenThreads::Mutex  _readCountMutex;
-#endif
-        unsigned int    _readCount;
+        // layout of _state
+        enum
+        {
+            READER              = 1,
+            READER_MASK         = 0x0001ffff,
+            WRITER_PENDING      = 1 << 17,
+            WRITER_PENDING_MASK = 0x3ff << 17,
+            UPGRADER            = 1 << 27,
+            WRITER              = 1 << 28,
+            PARKED              = 1 << 29
+        };
+
+        void addPendingWriter()
+        {
+            int32_t state = AtomicAdd(_state, WRITER_PENDING);
+
+            // the count of waiting writers must not carry into UPGRADER
+            assert((state & WRITER_PENDING_MASK)!=WRITER_PENDING_MASK && "ReadWriteMutex: too many waiting writers");
+            (void)state;
+        }
+
+        /** Sleep until _state changes from the value seen by the caller.*/
+        void park(int32_t state)
+        {
+            if ((state & PARKED)==0)
+            {
+                if (AtomicCompareExchange(_state, state | PARKED, state)!=state) return;
+                state |= PARKED;
+            }
+            FutexWait(_state, state);
+        }
+
+        void wakeParked()
+        {
+            AtomicAnd(_state, ~PARKED);
+            FutexWakeAll(_state);
+        }
+
+        int32_t volatile _state;
 
 };
 
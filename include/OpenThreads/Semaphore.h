@@ -0,0 +1,235 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// Semaphore - counting semaphores
+// ~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_SEMAPHORE_
+#define _OPENTHREADS_SEMAPHORE_
+
+#include <OpenThreads/AtomicFunctions.h>
+#include <OpenThreads/Futex.h>
+#include <OpenThreads/Condition.h>
+#include <errno.h>
+
+namespace OpenThreads {
+
+/**
+ *  @class Semaphore
+ *  @brief  Counting semaphore built directly on a futex word.
+ *
+ *  post() and an uncontended wait() are one atomic operation each, the kernel is only entered to put a thread to
+ *  sleep on an empty semaphore or to wake one up.
+ */
+class Semaphore
+{
+public:
+
+    explicit Semaphore(int32_t initialCount=0) : _count(initialCount), _waiters(0) {}
+
+    /**
+     *  Add count units and wake up as many waiting threads.
+     *
+     *  @return 0 if normal, -1 if errno set.
+     */
+    int post(int32_t count=1)
+    {
+        AtomicAdd(_count, count);
+
+        // full barrier above: either we see the waiter, or it sees the new count
+        if (_waiters!=0) return FutexWake(_count, count);
+        return 0;
+    }
+
+    /**
+     *  Take one unit, blocking until one is available.
+     *
+     *  @return 0 if normal.
+     */
+    int wait()
+    {
+        while (!tryWait())
+        {
+            AtomicIncrement(_waiters);
+            while (_count<=0) FutexWait(_count, 0);
+            AtomicDecrement(_waiters);
+        }
+        return 0;
+    }
+
+    /**
+     *  Take one unit if one is available, without blocking.
+     *
+     *  @return true if a unit was taken.
+     */
+    bool tryWait()
+    {
+        for (int32_t count = _count; count>0; count = _count)
+        {
+            if (AtomicCompareExchangeAcquire(_count, count-1, count)==count) return true;
+        }
+        return false;
+    }
+
+    /**
+     *  Take one unit, blocking for at most ns nanoseconds.
+     *
+     *  @return 0 if normal, ETIMEDOUT if no unit became available in time.
+     */
+    int waitFor(uint64_t ns)
+    {
+        uint64_t now = Condition::getMonotonicTime();
+        return waitUntil(ns < ~now ? now + ns : ~static_cast<uint64_t>(0));
+    }
+
+    /**
+     *  Take one unit, blocking at most until the deadline, given on the clock of Condition::getMonotonicTime().
+     *
+     *  @return 0 if normal, ETIMEDOUT if no unit became available in time.
+     */
+    int waitUntil(uint64_t deadlineNs)
+    {
+        while (!tryWait())
+        {
+            uint64_t now = Condition::getMonotonicTime();
+            if (now>=deadlineNs) return ETIMEDOUT;
+
+            AtomicIncrement(_waiters);
+            if (_count<=0) FutexWait(_count, 0, deadlineNs - now);
+            AtomicDecrement(_waiters);
+        }
+        return 0;
+    }
+
+    /**
+     *  Return the number of units currently available.
+     */
+    int32_t getValue() const { return _count; }
+
+private:
+
+    Semaphore(const Semaphore&);
+    Semaphore& operator=(const Semaphore&);
+
+    int32_t volatile _count;
+    int32_t volatile _waiters;
+};
+
+/**
+ *  @class LightweightSemaphore
+ *  @brief  Semaphore that spins for a little while before going to sleep.
+ *
+ *  The count goes negative while threads are waiting, so post() only has to wake sleepers when it sees a negative
+ *  count.  A thread that finds the semaphore empty spins on the count first, which avoids the sleep/wake round trip
+ *  through the kernel when the producer is only a few hundred cycles behind, as in tight producer/consumer hand-offs.
+ */
+class LightweightSemaphore
+{
+public:
+
+    explicit LightweightSemaphore(int32_t initialCount=0, unsigned int spinCount=10000) :
+        _count(initialCount),
+        _spinCount(spinCount) {}
+
+    /**
+     *  Add count units, waking up threads sleeping on the semaphore.
+     *
+     *  @return 0 if normal, -1 if errno set.
+     */
+    int post(int32_t count=1)
+    {
+        int32_t old = AtomicAdd(_count, count);
+        int32_t sleepers = old<0 ? -old : 0;
+        return sleepers ? _sema.post(sleepers<count ? sleepers : count) : 0;
+    }
+
+    /**
+     *  Take one unit, blocking until one is available.
+     *
+     *  @return 0 if normal.
+     */
+    int wait()
+    {
+        if (spinWait()) return 0;
+
+        if (AtomicDecrement(_count)<0) _sema.wait();
+        return 0;
+    }
+
+    /**
+     *  Take one unit if one is available, without blocking.
+     *
+     *  @return true if a unit was taken.
+     */
+    bool tryWait()
+    {
+        for (int32_t count = _count; count>0; count = _count)
+        {
+            if (AtomicCompareExchangeAcquire(_count, count-1, count)==count) return true;
+        }
+        return false;
+    }
+
+    /**
+     *  Take one unit, blocking for at most ns nanoseconds.
+     *
+     *  @return 0 if normal, ETIMEDOUT if no unit became available in time.
+     */
+    int waitFor(uint64_t ns)
+    {
+        if (spinWait()) return 0;
+
+        if (AtomicDecrement(_count)>=0) return 0;
+        if (_sema.waitFor(ns)==0) return 0;
+
+        // Timed out, give our place back.  If a post() got to us first it has
+        // released the inner semaphore for us and we have to take that unit.
+        for (int32_t count = _count; count<0; count = _count)
+        {
+            if (AtomicCompareExchange(_count, count+1, count)==count) return ETIMEDOUT;
+        }
+        _sema.wait();
+        return 0;
+    }
+
+    /**
+     *  Return the number of units currently available, negative when threads are waiting.
+     */
+    int32_t getValue() const { return _count; }
+
+private:
+
+    LightweightSemaphore(const LightweightSemaphore&);
+    LightweightSemaphore& operator=(const LightweightSemaphore&);
+
+    bool spinWait()
+    {
+        for (unsigned int i=0; i<_spinCount; ++i)
+        {
+            if (_count>0 && tryWait()) return true;
+            SpinPause();
+        }
+        return tryWait();
+    }
+
+    int32_t volatile _count;
+    unsigned int _spinCount;
+    Semaphore _sema;
+};
+
+}
+
+#endif // _OPENTHREADS_SEMAPHORE_
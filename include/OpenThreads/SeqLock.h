@@ -0,0 +1,187 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// SeqLock - sequence lock protecting a small value
+// ~~~~~~~
+//
+
+#ifndef _OPENTHREADS_SEQLOCK_
+#define _OPENTHREADS_SEQLOCK_
+
+#include <OpenThreads/AtomicFunctions.h>
+#include <OpenThreads/Spinlock.h>
+#include <OpenThreads/ScopedLock.h>
+#include <OpenThreads/Thread.h>
+
+namespace OpenThreads {
+
+/**
+ *  @class SeqLock
+ *  @brief  Sequence lock holding a copy of a small value, for data that is read far more often than it is written.
+ *
+ *  The writer makes a sequence counter odd while it updates the value and even again when done.  Readers copy the
+ *  value between two reads of the counter and retry when it was odd or has moved, so they never write to shared
+ *  memory and never slow down the writer or each other.
+ *
+ *  T must be copyable with a plain memory copy (no pointers to owned memory, no virtual functions), since readers
+ *  may copy it while it is being modified and throw the torn copy away.
+ *
+ *  Only one thread may write at a time, use MultiWriterSeqLock when several threads update the value.
+ */
+template<typename T>
+class SeqLock
+{
+public:
+
+    SeqLock() : _sequence(0), _value() {}
+
+    explicit SeqLock(const T& value) : _sequence(0), _value(value) {}
+
+    /**
+     *  Replace the value.
+     */
+    void write(const T& value)
+    {
+        beginWrite();
+        _value = value;
+        endWrite();
+    }
+
+    /**
+     *  Modify the value in place by calling func(T&).
+     */
+    template<class Func>
+    void update(Func func)
+    {
+        beginWrite();
+        func(_value);
+        endWrite();
+    }
+
+    /**
+     *  Return a consistent copy of the value.
+     */
+    T read() const
+    {
+        T value;
+        read(value);
+        return value;
+    }
+
+    /**
+     *  Copy a consistent snapshot of the value, retrying until no write overlapped the copy.
+     */
+    void read(T& value) const
+    {
+        while (!tryRead(value))
+        {
+            if (_sequence & 1) Thread::YieldCurrentThread();
+        }
+    }
+
+    /**
+     *  Make a single attempt at copying the value.
+     *
+     *  @return true if value holds a consistent snapshot, false if a write got in the way.
+     */
+    bool tryRead(T& value) const
+    {
+        int32_t sequence = _sequence;
+        if (sequence & 1) return false;
+
+        AtomicThreadFenceAcquire();
+        value = _value;
+        AtomicThreadFenceAcquire();
+
+        return _sequence==sequence;
+    }
+
+    /**
+     *  Return the number of writes since construction, times two.
+     */
+    int32_t getSequence() const { return _sequence; }
+
+protected:
+
+    void beginWrite()
+    {
+        _sequence = _sequence + 1;
+        AtomicThreadFenceRelease();
+    }
+
+    void endWrite()
+    {
+        AtomicThreadFenceRelease();
+        _sequence = _sequence + 1;
+    }
+
+    int32_t volatile _sequence;
+    T _value;
+
+private:
+
+    SeqLock(const SeqLock&);
+    SeqLock& operator=(const SeqLock&);
+};
+
+/**
+ *  @class MultiWriterSeqLock
+ *  @brief  SeqLock whose writers are serialized by a SpinLock, so that any thread may write.
+ *
+ *  It wraps a SeqLock rather than deriving from it, so that the unserialized writes of SeqLock cannot be reached
+ *  through a reference to the base class.
+ */
+template<typename T>
+class MultiWriterSeqLock
+{
+public:
+
+    MultiWriterSeqLock() {}
+
+    explicit MultiWriterSeqLock(const T& value) : _seqLock(value) {}
+
+    void write(const T& value)
+    {
+        ScopedLock<SpinLock> lock(_writeLock);
+        _seqLock.write(value);
+    }
+
+    template<class Func>
+    void update(Func func)
+    {
+        ScopedLock<SpinLock> lock(_writeLock);
+        _seqLock.update(func);
+    }
+
+    T read() const { return _seqLock.read(); }
+
+    void read(T& value) const { _seqLock.read(value); }
+
+    bool tryRead(T& value) const { return _seqLock.tryRead(value); }
+
+    int32_t getSequence() const { return _seqLock.getSequence(); }
+
+private:
+
+    MultiWriterSeqLock(const MultiWriterSeqLock&);
+    MultiWriterSeqLock& operator=(const MultiWriterSeqLock&);
+
+    SeqLock<T>  _seqLock;
+    SpinLock    _writeLock;
+};
+
+}
+
+#endif // _OPENTHREADS_SEQLOCK_
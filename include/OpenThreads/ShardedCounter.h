@@ -0,0 +1,147 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#ifndef _OPENTHREADS_SHARDEDCOUNTER_
+#define _OPENTHREADS_SHARDEDCOUNTER_
+
+#include <OpenThreads/AtomicFunctions.h>
+#include <OpenThreads/CacheAlignedArray.h>
+#include <OpenThreads/Condition.h>
+#include <OpenThreads/Thread.h>
+#include <stddef.h>
+
+namespace OpenThreads {
+
+/** ShardedCounter is a statistics counter that many threads can bump at a high rate.
+  *
+  * Each thread adds to its own cache line sized slot, picked with GetCurrentThreadSlot(),
+  * with a relaxed atomic add, so threads running on different cores never contend.
+  * Reading the counter sums all the slots; readApproximate() returns a cached sum for
+  * callers that poll it often.
+  *
+  * A read is not a snapshot: adds made while the slots are being summed may or may not
+  * be included.
+  */
+class ShardedCounter
+{
+    public:
+
+        /** Create the counter with numSlots slots, rounded up to a power of two.
+          * By default there is one slot per processor.*/
+        ShardedCounter(unsigned int numSlots=0):
+            _cachedValue(0),
+            _cacheTime(0),
+            _slots(RoundUpToPowerOfTwo(numSlots ? numSlots : static_cast<unsigned int>(GetNumberOfProcessors())))
+        {
+            _slotMask = static_cast<unsigned int>(_slots.size())-1;
+        }
+
+        void add(int64_t delta)
+        {
+            AtomicAddUnsafe(currentSlot().value, delta);
+        }
+
+        void increment() { add(1); }
+
+        ShardedCounter& operator += (int64_t delta) { add(delta); return *this; }
+
+        ShardedCounter& operator ++ () { add(1); return *this; }
+
+        /** Sum all the slots.*/
+        int64_t read() const
+        {
+            int64_t sum = 0;
+            for(unsigned int i=0; i<=_slotMask; ++i)
+            {
+                sum += _slots[i].value;
+            }
+            return sum;
+        }
+
+        /** Return a sum at most maxAgeNs nanoseconds old, only summing the slots again once
+          * the cached one has expired.*/
+        int64_t readApproximate(uint64_t maxAgeNs = 1000000) const
+        {
+            uint64_t now = Condition::getMonotonicTime();
+            if (now - static_cast<uint64_t>(_cacheTime) > maxAgeNs)
+            {
+                AtomicExchangeUnsafe(_cachedValue, read());
+                AtomicExchangeRelease(_cacheTime, static_cast<int64_t>(now));
+            }
+            return _cachedValue;
+        }
+
+        /** Set all the slots to zero.  Adds made concurrently may be lost.*/
+        void reset()
+        {
+            for(unsigned int i=0; i<=_slotMask; ++i)
+            {
+                AtomicExchange(_slots[i].value, 0);
+            }
+            AtomicExchange(_cacheTime, 0);
+        }
+
+        unsigned int getNumSlots() const { return _slotMask+1; }
+
+    protected:
+
+        struct Slot
+        {
+            int64_t volatile value;
+            char padding[OPENTHREADS_CACHE_LINE_SIZE - sizeof(int64_t)];
+        };
+
+        Slot& currentSlot() { return _slots[GetCurrentThreadSlot() & _slotMask]; }
+
+        // the cache is written by whichever reader finds it expired
+        mutable int64_t volatile    _cachedValue;
+        mutable int64_t volatile    _cacheTime;
+        unsigned int                _slotMask;
+        CacheAlignedArray<Slot>     _slots;
+
+    private:
+
+        ShardedCounter(const ShardedCounter&);
+        ShardedCounter& operator = (const ShardedCounter&);
+};
+
+/** ShardedGauge is a ShardedCounter for a level that goes up and down, such as the number
+  * of requests in flight.  Individual slots may go negative, only their sum is meaningful.
+  */
+class ShardedGauge : public ShardedCounter
+{
+    public:
+
+        ShardedGauge(unsigned int numSlots=0):
+            ShardedCounter(numSlots) {}
+
+        void subtract(int64_t delta) { add(-delta); }
+
+        void decrement() { add(-1); }
+
+        ShardedGauge& operator -= (int64_t delta) { add(-delta); return *this; }
+
+        ShardedGauge& operator -- () { add(-1); return *this; }
+
+        /** Set the level, by adding its difference with the current sum.  Changes made
+          * concurrently by other threads end up on top of value, or are overwritten.*/
+        void set(int64_t value)
+        {
+            add(value - read());
+            AtomicExchange(_cacheTime, 0);
+        }
+};
+
+}
+
+#endif
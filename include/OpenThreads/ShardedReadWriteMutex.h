@@ -0,0 +1,143 @@
+/* -*-c++-*- OpenThreads - Copyright (C) 1998-2007 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#ifndef _OPENTHREADS_SHARDEDREADWRITEMUTEX_
+#define _OPENTHREADS_SHARDEDREADWRITEMUTEX_
+
+#include <OpenThreads/ReadWriteMutex.h>
+#include <OpenThreads/Mutex.h>
+#include <OpenThreads/AtomicFunctions.h>
+#include <OpenThreads/CacheAlignedArray.h>
+#include <OpenThreads/Futex.h>
+
+namespace OpenThreads {
+
+/** ShardedReadWriteMutex is a "big reader" lock for data that is read all the time and
+  * written very rarely.
+  *
+  * Each thread counts its read locks in its own cache line sized slot, picked with
+  * GetCurrentThreadSlot(), so readers running on different cores never touch the same
+  * cache line.  The price is paid by writers, which have to visit every slot and wait
+  * for all of them to drain.
+  *
+  * It can be used wherever a ReadWriteMutex is expected, including with ScopedReadLock
+  * and ScopedWriteLock.  A read lock must be released by the thread that took it.
+  */
+class ShardedReadWriteMutex : public ReadWriteMutex
+{
+    public:
+
+        /** Create the lock with numSlots reader slots, rounded up to a power of two.
+          * By default there is one slot per processor.*/
+        ShardedReadWriteMutex(unsigned int numSlots=0):
+            _writer(0),
+            _slots(RoundUpToPowerOfTwo(numSlots ? numSlots : static_cast<unsigned int>(GetNumberOfProcessors())))
+        {
+            _slotMask = static_cast<unsigned int>(_slots.size())-1;
+        }
+
+        virtual int readLock()
+        {
+            Slot& slot = currentSlot();
+            for(;;)
+            {
+                // full barrier: the increment must be visible before _writer is checked
+                AtomicIncrement(slot.readers);
+                if (_writer==0) return 0;
+
+                // a writer is in, back off and let it drain our slot
+                if (AtomicDecrement(slot.readers)==0) FutexWake(slot.readers, 1);
+                while (_writer!=0) FutexWait(_writer, 1);
+            }
+        }
+
+        virtual int readUnlock()
+        {
+            Slot& slot = currentSlot();
+            if (AtomicDecrement(slot.readers)==0 && _writer!=0)
+            {
+                FutexWake(slot.readers, 1);
+            }
+            return 0;
+        }
+
+        virtual int writeLock()
+        {
+            _writerMutex.lock();
+            drainSlots();
+            return 0;
+        }
+
+        virtual int writeUnlock()
+        {
+            AtomicExchange(_writer, 0);
+            FutexWakeAll(_writer);
+            return _writerMutex.unlock();
+        }
+
+        /** Exclude other writers while still letting readers in.*/
+        virtual int upgradeLock()
+        {
+            return _writerMutex.lock();
+        }
+
+        virtual int upgradeUnlock()
+        {
+            return _writerMutex.unlock();
+        }
+
+        virtual int upgradeToWriteLock()
+        {
+            drainSlots();
+            return 0;
+        }
+
+        unsigned int getNumSlots() const { return _slotMask+1; }
+
+    protected:
+
+        struct Slot
+        {
+            int32_t volatile readers;
+            char padding[OPENTHREADS_CACHE_LINE_SIZE - sizeof(int32_t)];
+        };
+
+        Slot& currentSlot() { return _slots[GetCurrentThreadSlot() & _slotMask]; }
+
+        void drainSlots()
+        {
+            AtomicExchange(_writer, 1);
+            for(unsigned int i=0; i<=_slotMask; ++i)
+            {
+                Slot& slot = _slots[i];
+                for(int32_t readers = slot.readers; readers!=0; readers = slot.readers)
+                {
+                    FutexWait(slot.readers, readers);
+                }
+            }
+        }
+
+        OpenThreads::Mutex      _writerMutex;
+        int32_t volatile        _writer;
+        unsigned int            _slotMask;
+        CacheAlignedArray<Slot> _slots;
+
+    private:
+
+        ShardedReadWriteMutex(const ShardedReadWriteMutex&);
+        ShardedReadWriteMutex& operator = (const ShardedReadWriteMutex&);
+};
+
+}
+
+#endif
@@ -0,0 +1,354 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// SpscRingBuffer - bounded single producer, single consumer queue
+// ~~~~~~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_SPSCRINGBUFFER_
+#define _OPENTHREADS_SPSCRINGBUFFER_
+
+#include <OpenThreads/AtomicValue.h>
+#include <OpenThreads/CacheAlignedArray.h>
+#include <OpenThreads/EventCount.h>
+#include <stddef.h>
+#include <new>
+
+namespace OpenThreads {
+
+/**
+ *  @class SpscRingBuffer
+ *  @brief  Fixed capacity FIFO between exactly one producer thread and one consumer thread.
+ *
+ *  Both sides are wait-free.  The producer owns the tail index and the consumer the head index, each on its own
+ *  cache line.  Each side also keeps a private copy of the other side's index and only reads the shared one when the
+ *  copy says the buffer is full (producer) or empty (consumer), so that in the steady state a push or a pop touches
+ *  no cache line written by the other thread except the slot itself.
+ *
+ *  The producer calls tryPush() and pushN(), the consumer tryPop() and popN().  size() and empty() may be called from
+ *  either side and are only a hint.  BlockingSpscRingBuffer adds blocking push() and pop().
+ */
+template<typename T>
+class SpscRingBuffer
+{
+public:
+
+    /**
+     *  Create a buffer holding at least capacity elements, rounded up to a power of two.
+     */
+    explicit SpscRingBuffer(size_t capacity) :
+        _head(0),
+        _cachedTail(0),
+        _tail(0),
+        _cachedHead(0)
+    {
+        size_t size = 1;
+        while (size<capacity) size <<= 1;
+        _mask = size - 1;
+        _slots = static_cast<T*>(AllocateAligned(size * sizeof(T), alignof(T)));
+    }
+
+    /**
+     *  Destroy the elements still in the buffer.  Neither thread may use it any more.
+     */
+    ~SpscRingBuffer()
+    {
+        for(size_t index = _head.load(); index!=_tail.load(); ++index)
+        {
+            _slots[index & _mask].~T();
+        }
+        DeallocateAligned(_slots, alignof(T));
+    }
+
+    /**
+     *  Append a copy of value.  Producer only.
+     *
+     *  @return  false if the buffer is full.
+     */
+    bool tryPush(const T& value)
+    {
+        size_t tail = _tail.load(MEMORY_ORDER_RELAXED);
+        if (tail - _cachedHead > _mask)
+        {
+            _cachedHead = _head.load(MEMORY_ORDER_ACQUIRE);
+            if (tail - _cachedHead > _mask) return false;
+        }
+
+        new (&_slots[tail & _mask]) T(value);
+        _tail.store(tail + 1, MEMORY_ORDER_RELEASE);
+        return true;
+    }
+
+    /**
+     *  Append copies of as many of the count elements at values as there is room for, publishing them all at once.
+     *  Producer only.
+     *
+     *  @return  The number of elements appended.
+     */
+    size_t pushN(const T* values, size_t count)
+    {
+        size_t tail = _tail.load(MEMORY_ORDER_RELAXED);
+        size_t room = _mask + 1 - (tail - _cachedHead);
+        if (room<count)
+        {
+            _cachedHead = _head.load(MEMORY_ORDER_ACQUIRE);
+            room = _mask + 1 - (tail - _cachedHead);
+        }
+        if (count>room) count = room;
+
+        for(size_t i=0; i<count; ++i)
+        {
+            new (&_slots[(tail + i) & _mask]) T(values[i]);
+        }
+        if (count) _tail.store(tail + count, MEMORY_ORDER_RELEASE);
+        return count;
+    }
+
+    /**
+     *  Remove the oldest element and assign it to value.  Consumer only.
+     *
+     *  @return  false if the buffer is empty.
+     */
+    bool tryPop(T& value)
+    {
+        size_t head = _head.load(MEMORY_ORDER_RELAXED);
+        if (head==_cachedTail)
+        {
+            _cachedTail = _tail.load(MEMORY_ORDER_ACQUIRE);
+            if (head==_cachedTail) return false;
+        }
+
+        T* slot = &_slots[head & _mask];
+        value = *slot;
+        slot->~T();
+        _head.store(head + 1, MEMORY_ORDER_RELEASE);
+        return true;
+    }
+
+    /**
+     *  Remove up to maxCount of the oldest elements, assigning them to values[0], values[1]...  Consumer only.
+     *
+     *  @return  The number of elements removed.
+     */
+    size_t popN(T* values, size_t maxCount)
+    {
+        size_t head = _head.load(MEMORY_ORDER_RELAXED);
+        size_t available = _cachedTail - head;
+        if (available<maxCount)
+        {
+            _cachedTail = _tail.load(MEMORY_ORDER_ACQUIRE);
+            available = _cachedTail - head;
+        }
+        if (maxCount>available) maxCount = available;
+
+        for(size_t i=0; i<maxCount; ++i)
+        {
+            T* slot = &_slots[(head + i) & _mask];
+            values[i] = *slot;
+            slot->~T();
+        }
+        if (maxCount) _head.store(head + maxCount, MEMORY_ORDER_RELEASE);
+        return maxCount;
+    }
+
+    /** Return the number of elements in the buffer.*/
+    size_t size() const
+    {
+        size_t head = _head.load(MEMORY_ORDER_ACQUIRE);
+        return _tail.load(MEMORY_ORDER_ACQUIRE) - head;
+    }
+
+    bool empty() const { return size()==0; }
+
+    size_t getCapacity() const { return _mask + 1; }
+
+private:
+
+    SpscRingBuffer(const SpscRingBuffer&);
+    SpscRingBuffer& operator=(const SpscRingBuffer&);
+
+    char                _padding0[OPENTHREADS_CACHE_LINE_SIZE];
+
+    // consumer side
+    AtomicValue<size_t> _head;
+    size_t              _cachedTail;
+    char                _padding1[OPENTHREADS_CACHE_LINE_SIZE];
+
+    // producer side
+    AtomicValue<size_t> _tail;
+    size_t              _cachedHead;
+    char                _padding2[OPENTHREADS_CACHE_LINE_SIZE];
+
+    // read-only after construction
+    size_t              _mask;
+    T*                  _slots;
+};
+
+/**
+ *  @class BlockingSpscRingBuffer
+ *  @brief  SpscRingBuffer whose push() waits while the buffer is full and pop() while it is empty.
+ *
+ *  A side that has to wait spins briefly and then sleeps on an EventCount.  When the other side is not asleep, waking
+ *  it up costs a memory barrier and a load per push or pop.
+ */
+template<typename T>
+class BlockingSpscRingBuffer
+{
+public:
+
+    explicit BlockingSpscRingBuffer(size_t capacity) : _buffer(capacity) {}
+
+    /**
+     *  Append a copy of value, waiting for room if the buffer is full.  Producer only.
+     */
+    void push(const T& value)
+    {
+        if (!_buffer.tryPush(value))
+        {
+            for(unsigned int spins = 0; !_buffer.tryPush(value); ++spins)
+            {
+                if (spins<SPIN_COUNT)
+                {
+                    SpinPause();
+                    continue;
+                }
+
+                EventCount::Key key = _notFull.prepareWait();
+                if (_buffer.tryPush(value))
+                {
+                    _notFull.cancelWait();
+                    break;
+                }
+                _notFull.commitWait(key);
+            }
+        }
+        _notEmpty.notify();
+    }
+
+    bool tryPush(const T& value)
+    {
+        if (!_buffer.tryPush(value)) return false;
+        _notEmpty.notify();
+        return true;
+    }
+
+    /**
+     *  Append as many of the count elements at values as there is room for, without waiting.  Producer only.
+     */
+    size_t pushN(const T* values, size_t count)
+    {
+        count = _buffer.pushN(values, count);
+        if (count) _notEmpty.notify();
+        return count;
+    }
+
+    /**
+     *  Remove the oldest element, waiting for one if the buffer is empty.  Consumer only.
+     */
+    void pop(T& value)
+    {
+        if (!_buffer.tryPop(value))
+        {
+            for(unsigned int spins = 0; !_buffer.tryPop(value); ++spins)
+            {
+                if (spins<SPIN_COUNT)
+                {
+                    SpinPause();
+                    continue;
+                }
+
+                EventCount::Key key = _notEmpty.prepareWait();
+                if (_buffer.tryPop(value))
+                {
+                    _notEmpty.cancelWait();
+                    break;
+                }
+                _notEmpty.commitWait(key);
+            }
+        }
+        _notFull.notify();
+    }
+
+    /**
+     *  Remove the oldest element, waiting at most timeoutNs nanoseconds for one.  Consumer only.
+     *
+     *  @return  false if the buffer stayed empty.
+     */
+    bool popFor(T& value, uint64_t timeoutNs)
+    {
+        if (!_buffer.tryPop(value))
+        {
+            uint64_t deadline = Condition::getMonotonicTime() + timeoutNs;
+            for(;;)
+            {
+                EventCount::Key key = _notEmpty.prepareWait();
+                if (_buffer.tryPop(value))
+                {
+                    _notEmpty.cancelWait();
+                    break;
+                }
+
+                uint64_t now = Condition::getMonotonicTime();
+                if (now>=deadline)
+                {
+                    _notEmpty.cancelWait();
+                    return false;
+                }
+                _notEmpty.commitWait(key, deadline - now);
+            }
+        }
+        _notFull.notify();
+        return true;
+    }
+
+    bool tryPop(T& value)
+    {
+        if (!_buffer.tryPop(value)) return false;
+        _notFull.notify();
+        return true;
+    }
+
+    /**
+     *  Remove up to maxCount of the oldest elements without waiting.  Consumer only.
+     */
+    size_t popN(T* values, size_t maxCount)
+    {
+        maxCount = _buffer.popN(values, maxCount);
+        if (maxCount) _notFull.notify();
+        return maxCount;
+    }
+
+    size_t size() const { return _buffer.size(); }
+
+    bool empty() const { return _buffer.empty(); }
+
+    size_t getCapacity() const { return _buffer.getCapacity(); }
+
+private:
+
+    // handoffs between running threads take well under this many pauses
+    enum { SPIN_COUNT = 1000 };
+
+    BlockingSpscRingBuffer(const BlockingSpscRingBuffer&);
+    BlockingSpscRingBuffer& operator=(const BlockingSpscRingBuffer&);
+
+    SpscRingBuffer<T>   _buffer;
+    EventCount          _notEmpty;
+    EventCount          _notFull;
+};
+
+}
+
+#endif // _OPENTHREADS_SPSCRINGBUFFER_
@@ -0,0 +1,177 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// TaggedPtr - atomic pointer with a version counter
+// ~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_TAGGEDPTR_
+#define _OPENTHREADS_TAGGEDPTR_
+
+#include <OpenThreads/AtomicFunctions.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace OpenThreads {
+
+template<size_t Size> struct TaggedPtrStorage;
+
+// 32-bit targets: pointer and tag fit in 64 bits
+template<>
+struct TaggedPtrStorage<8>
+{
+    typedef int64_t type;
+
+    static type load(type volatile const& value) { return value; }
+
+    static type compareExchange(type volatile& value, type desired, type compare)
+    {
+        return AtomicCompareExchange(value, desired, compare);
+    }
+};
+
+// 64-bit targets: double-width compare-and-swap
+template<>
+struct TaggedPtrStorage<16>
+{
+    typedef AtomicInt128 type;
+
+    static type load(type volatile const& value)
+    {
+        // each half is read atomically, a torn pair only makes the next
+        // compareExchange() fail since the tag changes with every update.
+        type result;
+        result.high = value.high;
+        result.low = value.low;
+        return result;
+    }
+
+    static type compareExchange(type volatile& value, type desired, type compare)
+    {
+        return AtomicCompareExchange128(value, desired, compare);
+    }
+};
+
+/**
+ *  @class TaggedPtr
+ *  @brief  Atomic pointer paired with a version tag that is incremented by every update.
+ *
+ *  A compare-and-swap on a plain pointer succeeds when the pointer has been changed and changed back meanwhile (the
+ *  ABA problem), which corrupts lock-free stacks and free lists that reuse their nodes.  Comparing the tag as well
+ *  makes such a compareExchange() fail.
+ *
+ *  The pointer and the tag are updated together with a double-width compare-and-swap, see
+ *  AtomicCompareExchange128().  Nodes read through a TaggedPtr may be dereferenced after they have been popped by
+ *  another thread, so they must stay allocated (pooled) as long as the structure is in use; use HazardPointer when
+ *  nodes are freed.
+ *
+ *  @code
+ *  TaggedPtr<Node>::Value head = _head.load();
+ *  do
+ *  {
+ *      if (!head.pointer) return 0;
+ *  }
+ *  while (!_head.compareExchange(head, head.pointer->next));
+ *  @endcode
+ */
+template<typename T>
+class TaggedPtr
+{
+public:
+
+    /** Snapshot of the pointer and of its tag.*/
+    struct Value
+    {
+        T*          pointer;
+        uintptr_t   tag;
+    };
+
+    explicit TaggedPtr(T* pointer = 0) : _storage(pack(makeValue(pointer, 0))) {}
+
+    /**
+     *  Read the pointer and the tag, with acquire semantics.
+     */
+    Value load() const
+    {
+        Value value = unpack(Storage::load(_storage));
+        AtomicThreadFenceAcquire();
+        return value;
+    }
+
+    T* get() const { return load().pointer; }
+
+    /**
+     *  Replace the pointer with desired, and increment the tag, if the current pointer and tag are those of expected.
+     *  Otherwise load them into expected.  Full memory barriers.
+     *
+     *  @return  true if the pointer was replaced.
+     */
+    bool compareExchange(Value& expected, T* desired)
+    {
+        StorageType compare = pack(expected);
+        StorageType original = Storage::compareExchange(_storage, pack(makeValue(desired, expected.tag + 1)), compare);
+        if (memcmp(&original, &compare, sizeof(StorageType))==0) return true;
+
+        expected = unpack(original);
+        return false;
+    }
+
+    /**
+     *  Replace the pointer unconditionally, and increment the tag.
+     *
+     *  @return  The previous pointer.
+     */
+    T* exchange(T* desired)
+    {
+        Value expected = load();
+        while (!compareExchange(expected, desired)) {}
+        return expected.pointer;
+    }
+
+private:
+
+    typedef TaggedPtrStorage<sizeof(Value)> Storage;
+    typedef typename Storage::type StorageType;
+
+    static Value makeValue(T* pointer, uintptr_t tag)
+    {
+        Value value = { pointer, tag };
+        return value;
+    }
+
+    static StorageType pack(const Value& value)
+    {
+        StorageType storage;
+        memset(&storage, 0, sizeof(storage));
+        memcpy(&storage, &value, sizeof(value));
+        return storage;
+    }
+
+    static Value unpack(const StorageType& storage)
+    {
+        Value value;
+        memcpy(&value, &storage, sizeof(value));
+        return value;
+    }
+
+    TaggedPtr(const TaggedPtr&);
+    TaggedPtr& operator=(const TaggedPtr&);
+
+    StorageType volatile _storage;
+};
+
+}
+
+#endif // _OPENTHREADS_TAGGEDPTR_
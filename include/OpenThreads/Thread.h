@@ -42,6 +42,16 @@ extern OPENTHREAD_EXPORT_DIRECTIVE int GetNumberOfProcessors();
  */
 extern OPENTHREAD_EXPORT_DIRECTIVE int SetProcessorAffinityOfCurrentThread(unsigned int cpunum);
 
+/**
+ *  Get a small index identifying the calling thread.
+ *
+ *  Indices are handed out in order of first call, starting at 0, and stay the
+ *  same for the lifetime of the thread.  They are meant to pick a per-thread
+ *  slot in sharded data structures, typically as GetCurrentThreadSlot() & mask.
+ *
+ */
+extern OPENTHREAD_EXPORT_DIRECTIVE unsigned int GetCurrentThreadSlot();
+
 /**
  *  @class Thread
  *  @brief  This class provides an object-oriented thread interface.
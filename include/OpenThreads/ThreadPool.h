@@ -24,7 +24,8 @@
 #define _OPENTHREADS_THREADPOOL_
 
 #include <OpenThreads/Thread.h>
-#include <OpenThreads/Condition.h>
+#include <OpenThreads/MpscQueue.h>
+#include <OpenThreads/ObjectPool.h>
 #include <map>
 #include <list>
 #include <memory>
@@ -54,7 +55,11 @@ private:
 };
 
 	
-class OPENTHREAD_EXPORT_DIRECTIVE Task {
+// Tasks are linked into the worker's queue through their MpscQueueNode base,
+// a task can only be queued once at a time: it may be queued again once a
+// worker has taken it out of its queue, from execute() or completed().
+// Debug builds assert on a task queued twice.
+class OPENTHREAD_EXPORT_DIRECTIVE Task : public MpscQueueNode {
 
 public:
 
@@ -62,6 +67,45 @@ public:
 	virtual ~Task();
 
 	virtual void execute(TaskContext& ctxt) = 0;
+
+	// Called by the worker once execute() has returned, the task is not
+	// touched by the pool afterwards and may delete or recycle itself here.
+	virtual void completed() {}
+
+private:
+	friend class WorkerThread;
+
+	// set by WorkerThread::queue() and cleared by the worker, debug builds only
+	int32_t volatile _queued;
+};
+
+
+// Task created from an ObjectPool, which gives itself back to the pool once
+// a worker has executed it. Create it with PooledTask<T>::create(pool) so
+// that it knows its pool.
+template<class T>
+class PooledTask : public Task {
+
+public:
+
+	template<typename... Args>
+	static T* create(ObjectPool<T>& pool, Args&&... args)
+	{
+		T* task = pool.create(std::forward<Args>(args)...);
+		task->_origin = &pool;
+		return task;
+	}
+
+	PooledTask() : _origin(nullptr) {}
+
+	virtual void completed()
+	{
+		if (_origin)
+			_origin->destroy(static_cast<T*>(this));
+	}
+
+private:
+	ObjectPool<T>* _origin;
 };
 
 
@@ -78,25 +122,34 @@ public:
 
 	void stop(bool finishTasks);
 
+	// Cancel the thread, waking it up if it waits for a task.
+	virtual int cancel();
+
 protected:
 	virtual void init() {}
 	virtual void executeTask(Task* task);
 
 protected:
-	Condition _condition;
-	Mutex _mutex;
-
-	typedef std::list<Task*> Tasks;
+	typedef BlockingMpscQueue<Task> Tasks;
 	Tasks _tasks;
 
 	enum Flag
 	{
 		STOPPING			= 1,
 		STOP_AFTER_TASKS	= 2,
+		CANCELLING			= 4,
 	};
 
 private:
 	bool shouldStop();
+
+	// queued by stop() and cancel() to wake the worker up
+	class WakeUpTask : public Task {
+	public:
+		virtual void execute(TaskContext&) {}
+	};
+	WakeUpTask _wakeUpTask;
+	WakeUpTask _cancelWakeUpTask;
 	
 private:
 	friend class ThreadPool;
@@ -104,7 +157,7 @@ private:
 	void setPool(ThreadPool* pool);
 	ThreadPool* _pool;
 	TaskContext _context;
-	unsigned int _flags;
+	int32_t volatile _flags;
 };
 
 class OPENTHREAD_EXPORT_DIRECTIVE ThreadPool {
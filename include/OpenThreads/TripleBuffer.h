@@ -0,0 +1,284 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+
+//
+// TripleBuffer - hand whole values from one writer thread to one reader thread
+// ~~~~~~~~~~~~
+//
+
+#ifndef _OPENTHREADS_TRIPLEBUFFER_
+#define _OPENTHREADS_TRIPLEBUFFER_
+
+#include <OpenThreads/AtomicValue.h>
+#include <OpenThreads/EventCount.h>
+
+namespace OpenThreads {
+
+/**
+ *  @class TripleBuffer
+ *  @brief  Latest value exchange between one writer thread and one reader thread, wait-free on both sides.
+ *
+ *  The writer fills its back buffer and publish()es it, the reader update()s to the most recently published buffer
+ *  and reads it for as long as it likes.  A third buffer sits in between, so that neither side ever waits for the
+ *  other: publishing swaps the back buffer with the middle one, updating swaps the front buffer with the middle one,
+ *  each with a single atomic exchange.  Values published while the reader does not update are overwritten, the
+ *  reader always gets the latest complete one.
+ *
+ *  Typical use is an update thread producing per-frame state for a cull or draw thread:
+ *
+ *  @code
+ *  // update thread
+ *  FrameState& state = buffer.getWriteBuffer();
+ *  fill(state);
+ *  buffer.publish();
+ *
+ *  // draw thread, once per frame
+ *  buffer.update();
+ *  draw(buffer.getReadBuffer());
+ *  @endcode
+ *
+ *  Buffers are reused, not reconstructed: the write buffer holds whatever value it held when the reader released it.
+ */
+template<typename T>
+class TripleBuffer
+{
+public:
+
+    explicit TripleBuffer(const T& initial = T()) :
+        _front(0),
+        _back(2)
+    {
+        for(int i=0; i<3; ++i) _slots[i].value = initial;
+        _middle.store(1, MEMORY_ORDER_RELAXED);
+    }
+
+    /**
+     *  Return the buffer the writer fills.  Writer only.
+     */
+    T& getWriteBuffer() { return _slots[_back].value; }
+
+    /**
+     *  Make the write buffer the latest value and get another buffer to write to.  Writer only.
+     */
+    void publish()
+    {
+        int32_t middle = _middle.exchange(_back | DIRTY, MEMORY_ORDER_ACQ_REL);
+        _back = middle & INDEX_MASK;
+    }
+
+    /**
+     *  Copy value to the write buffer and publish it.  Writer only.
+     */
+    void write(const T& value)
+    {
+        getWriteBuffer() = value;
+        publish();
+    }
+
+    /**
+     *  Switch the read buffer to the latest published value, if there is a new one.  Reader only.
+     *
+     *  @return  true if the read buffer changed.
+     */
+    bool update()
+    {
+        if (!(_middle.load(MEMORY_ORDER_RELAXED) & DIRTY)) return false;
+
+        int32_t middle = _middle.exchange(_front, MEMORY_ORDER_ACQ_REL);
+        _front = middle & INDEX_MASK;
+        return true;
+    }
+
+    /**
+     *  Return the buffer the reader reads, which stays the same until the next update().  Reader only.
+     */
+    const T& getReadBuffer() const { return _slots[_front].value; }
+
+    /**
+     *  Update and copy the latest value to value.  Reader only.
+     *
+     *  @return  true if the value is new since the previous update().
+     */
+    bool read(T& value)
+    {
+        bool changed = update();
+        value = getReadBuffer();
+        return changed;
+    }
+
+    /** Return true if a value was published since the reader's last update().*/
+    bool hasUpdate() const { return (_middle.load(MEMORY_ORDER_ACQUIRE) & DIRTY)!=0; }
+
+private:
+
+    // the middle index with a flag telling whether the reader has seen it
+    enum { INDEX_MASK = 3, DIRTY = 4 };
+
+    struct Slot
+    {
+        T       value;
+        char    padding[OPENTHREADS_CACHE_LINE_SIZE];
+    };
+
+    TripleBuffer(const TripleBuffer&);
+    TripleBuffer& operator=(const TripleBuffer&);
+
+    Slot                    _slots[3];
+
+    // reader
+    int32_t                 _front;
+    char                    _padding0[OPENTHREADS_CACHE_LINE_SIZE];
+
+    AtomicValue<int32_t>    _middle;
+    char                    _padding1[OPENTHREADS_CACHE_LINE_SIZE];
+
+    // writer
+    int32_t                 _back;
+};
+
+/**
+ *  @class DoubleBuffer
+ *  @brief  Front and back buffer between one writer thread and one reader thread, swapped at a fence.
+ *
+ *  Takes one buffer less than TripleBuffer, at the price of a rendezvous: swap() publishes the back buffer and then
+ *  waits, if needed, until the reader has finished with the previous front buffer, which becomes the new back buffer.
+ *  The reader never waits.  It brackets its accesses with beginRead() and endRead(), and always reads the buffer that
+ *  was the front one when it called beginRead().
+ *
+ *  @code
+ *  // update thread
+ *  fill(buffer.getWriteBuffer());
+ *  buffer.swap();
+ *
+ *  // draw thread
+ *  const FrameState& state = buffer.beginRead();
+ *  draw(state);
+ *  buffer.endRead();
+ *  @endcode
+ *
+ *  After swap() the back buffer holds the value of two swaps ago, not a copy of the front buffer.
+ */
+template<typename T>
+class DoubleBuffer
+{
+public:
+
+    explicit DoubleBuffer(const T& initial = T()) :
+        _back(1)
+    {
+        _slots[0].value = initial;
+        _slots[1].value = initial;
+        _front.store(0, MEMORY_ORDER_RELAXED);
+        _reading.store(0, MEMORY_ORDER_RELAXED);
+    }
+
+    /**
+     *  Return the back buffer.  Writer only.
+     */
+    T& getWriteBuffer() { return _slots[_back].value; }
+
+    /**
+     *  Make the back buffer the front one, and wait until the reader has left the old front buffer so that the writer
+     *  can fill it.  Writer only.
+     */
+    void swap()
+    {
+        // sequentially consistent store and load, paired with those of beginRead(): either we see the reader
+        // on the old front buffer, or it sees the new one
+        _front.store(_back, MEMORY_ORDER_SEQ_CST);
+        _back = 1 - _back;
+
+        int32_t busy = _back + 1;
+        if (_reading.load(MEMORY_ORDER_SEQ_CST)!=busy) return;
+
+        for(unsigned int spins = 0; spins<SPIN_COUNT; ++spins)
+        {
+            SpinPause();
+            if (_reading.load(MEMORY_ORDER_ACQUIRE)!=busy) return;
+        }
+
+        while (_reading.load(MEMORY_ORDER_ACQUIRE)==busy)
+        {
+            EventCount::Key key = _readDone.prepareWait();
+            if (_reading.load(MEMORY_ORDER_ACQUIRE)!=busy)
+            {
+                _readDone.cancelWait();
+                break;
+            }
+            _readDone.commitWait(key);
+        }
+    }
+
+    /**
+     *  Start reading the front buffer.  Reader only, calls must not nest.
+     */
+    const T& beginRead()
+    {
+        int32_t front = _front.load(MEMORY_ORDER_ACQUIRE);
+        bool moved = false;
+        for(;;)
+        {
+            _reading.store(front + 1, MEMORY_ORDER_SEQ_CST);
+
+            // a swap in between may not have seen us, follow it
+            int32_t current = _front.load(MEMORY_ORDER_SEQ_CST);
+            if (current==front) break;
+            front = current;
+            moved = true;
+        }
+
+        // a swap that saw us on the buffer we just left may be asleep waiting for it
+        if (moved) _readDone.notify();
+        return _slots[front].value;
+    }
+
+    /**
+     *  Finish reading, and let a swap() waiting for the buffer go on.  Reader only.
+     */
+    void endRead()
+    {
+        _reading.store(0, MEMORY_ORDER_RELEASE);
+        _readDone.notify();
+    }
+
+private:
+
+    // a swap waits for a reader still on the buffer for this many pauses before it sleeps
+    enum { SPIN_COUNT = 1000 };
+
+    struct Slot
+    {
+        T       value;
+        char    padding[OPENTHREADS_CACHE_LINE_SIZE];
+    };
+
+    DoubleBuffer(const DoubleBuffer&);
+    DoubleBuffer& operator=(const DoubleBuffer&);
+
+    Slot                    _slots[2];
+
+    AtomicValue<int32_t>    _front;
+
+    // 1 + the index of the buffer the reader is on, 0 outside beginRead() / endRead()
+    AtomicValue<int32_t>    _reading;
+    char                    _padding0[OPENTHREADS_CACHE_LINE_SIZE];
+
+    // writer
+    int32_t                 _back;
+    EventCount              _readDone;
+};
+
+}
+
+#endif // _OPENTHREADS_TRIPLEBUFFER_
@@ -0,0 +1,165 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <OpenThreads/Arena.h>
+#include <stdlib.h>
+
+using namespace OpenThreads;
+
+//----------------------------------------------------------------------------
+// Header of a block, followed by its memory.  Blocks form a list in the
+// order they are used in, reset() starts again from the first one.
+//
+struct Arena::Block
+{
+    Block*  next;
+    size_t  size;
+
+    char* begin() { return reinterpret_cast<char*>(this + 1); }
+    char* end() { return begin() + size; }
+};
+
+Arena::Arena(size_t blockSize) :
+    _blockSize(blockSize),
+    _first(0),
+    _current(0),
+    _position(0),
+    _end(0),
+    _capacity(0)
+{
+}
+
+Arena::~Arena()
+{
+    while (_first)
+    {
+        Block* next = _first->next;
+        free(_first);
+        _first = next;
+    }
+}
+
+void Arena::setCurrent(Block* block)
+{
+    _current = block;
+    _position = block ? block->begin() : 0;
+    _end = block ? block->end() : 0;
+}
+
+void* Arena::allocateSlow(size_t size, size_t alignment)
+{
+    // room for the worst case alignment of the start of a block
+    size_t needed = size + alignment;
+    if (needed<size) throw std::bad_alloc();
+
+    // move on to the next kept block, unless it is too small for this one
+    Block* next = _current ? _current->next : _first;
+    if (!next || next->size<needed)
+    {
+        size_t blockSize = needed>_blockSize ? needed : _blockSize;
+        if (blockSize + sizeof(Block)<blockSize) throw std::bad_alloc();
+
+        Block* block = static_cast<Block*>(malloc(sizeof(Block) + blockSize));
+        if (!block) throw std::bad_alloc();
+        block->size = blockSize;
+        _capacity += blockSize;
+
+        // insert in front of the kept block, which stays for later rounds
+        block->next = next;
+        if (_current) _current->next = block;
+        else _first = block;
+        next = block;
+    }
+
+    setCurrent(next);
+
+    char* position = alignUp(_position, alignment);
+    _position = position + size;
+    return position;
+}
+
+void Arena::rewind(const Marker& marker)
+{
+    if (!marker.block)
+    {
+        reset();
+        return;
+    }
+
+    _current = static_cast<Block*>(marker.block);
+    _position = marker.position;
+    _end = _current->end();
+}
+
+void Arena::reset()
+{
+    setCurrent(_first);
+}
+
+void Arena::trim()
+{
+    if (!_first) return;
+
+    Block* block = _first->next;
+    while (block)
+    {
+        Block* next = block->next;
+        _capacity -= block->size;
+        free(block);
+        block = next;
+    }
+    _first->next = 0;
+    reset();
+}
+
+namespace {
+
+//----------------------------------------------------------------------------
+// Owner of the calling thread's arena, which deletes it at thread exit if
+// nothing released it before.
+//
+struct ThreadArena
+{
+    ThreadArena() : arena(0) {}
+
+    ~ThreadArena()
+    {
+        delete arena;
+        arena = 0;
+    }
+
+    Arena*  arena;
+};
+
+thread_local ThreadArena t_threadArena;
+
+}
+
+Arena& ThreadLocalArena::get()
+{
+    ThreadArena& threadArena = t_threadArena;
+    if (!threadArena.arena) threadArena.arena = new Arena;
+    return *threadArena.arena;
+}
+
+void ThreadLocalArena::reset()
+{
+    if (Arena* arena = t_threadArena.arena) arena->reset();
+}
+
+void ThreadLocalArena::release()
+{
+    ThreadArena& threadArena = t_threadArena;
+    delete threadArena.arena;
+    threadArena.arena = 0;
+}
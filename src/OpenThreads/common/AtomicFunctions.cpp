@@ -1,10 +1,14 @@
 #include <OpenThreads/AtomicFunctions.h>
+#include <string.h>
 
 
 #ifdef _WIN32 
 #error "Win32 has their own intrinsics, use it instead Clang/Gcc ones!"
 #endif
 
+// With the __atomic builtins the functions are inline in the header, this is
+// the implementation for older compilers that only have the __sync builtins.
+#if !defined(_OPENTHREADS_ATOMIC_USE_GCC_ATOMIC_BUILTINS)
 
 #define _GENERATE_ATOMIC_WORKER( PREFIX, OPERATION, PARAM_LIST, ACTION ) \
     PREFIX OpenThreads::Atomic##OPERATION PARAM_LIST ACTION \
@@ -17,7 +21,13 @@ _GENERATE_ATOMIC_WORKER(
     Exchange,
     ( int32_t volatile & rAtomic, int32_t value ),
     {
-        return __sync_val_compare_and_swap( static_cast< int32_t volatile* >( &rAtomic ), *static_cast< int32_t volatile* >( &rAtomic ), value );
+        int32_t original;
+        do
+        {
+            original = rAtomic;
+        } while( !__sync_bool_compare_and_swap( static_cast< int32_t volatile* >( &rAtomic ), original, value ) );
+
+        return original;
     } )
 
 _GENERATE_ATOMIC_WORKER(
@@ -90,7 +100,13 @@ _GENERATE_ATOMIC_WORKER(
     Exchange,
     ( int64_t volatile & rAtomic, int64_t value ),
     {
-        return __sync_val_compare_and_swap( static_cast< int64_t volatile* >( &rAtomic ), *static_cast< int64_t volatile* >( &rAtomic ), value );
+        int64_t original;
+        do
+        {
+            original = rAtomic;
+        } while( !__sync_bool_compare_and_swap( static_cast< int64_t volatile* >( &rAtomic ), original, value ) );
+
+        return original;
     } )
 
 _GENERATE_ATOMIC_WORKER(
@@ -164,7 +180,13 @@ _GENERATE_ATOMIC_WORKER(
     ExchangePointer,
     ( void* volatile & rAtomic, void* value ),
     {
-        return static_cast<void*>( __sync_val_compare_and_swap( static_cast< void* volatile* >( &rAtomic ), rAtomic, value ) );
+        void* original;
+        do
+        {
+            original = rAtomic;
+        } while( !__sync_bool_compare_and_swap( static_cast< void* volatile* >( &rAtomic ), original, value ) );
+
+        return original;
     } )
 
 _GENERATE_ATOMIC_WORKER(
@@ -176,3 +198,113 @@ _GENERATE_ATOMIC_WORKER(
     } )
 
 #undef _GENERATE_ATOMIC_WORKER
+
+void OpenThreads::AtomicThreadFence()
+{
+    __sync_synchronize();
+}
+
+void OpenThreads::AtomicThreadFenceAcquire()
+{
+#if defined(__ATOMIC_ACQUIRE)
+    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+#else
+    __sync_synchronize();
+#endif
+}
+
+void OpenThreads::AtomicThreadFenceRelease()
+{
+#if defined(__ATOMIC_RELEASE)
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+#else
+    __sync_synchronize();
+#endif
+}
+
+#endif
+
+//----- 128 bit, implemented here whichever builtins are available
+
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+
+OpenThreads::AtomicInt128 OpenThreads::AtomicCompareExchange128( AtomicInt128 volatile & rAtomic, AtomicInt128 value, AtomicInt128 compare )
+{
+    unsigned __int128 newValue, compareValue;
+    memcpy( &newValue, &value, sizeof(value) );
+    memcpy( &compareValue, &compare, sizeof(compare) );
+
+    unsigned __int128 original = __sync_val_compare_and_swap(
+        reinterpret_cast< unsigned __int128 volatile* >( &rAtomic ), compareValue, newValue );
+
+    AtomicInt128 result;
+    memcpy( &result, &original, sizeof(result) );
+    return result;
+}
+
+bool OpenThreads::AtomicCompareExchange128IsLockFree()
+{
+    return true;
+}
+
+#elif defined(__x86_64__)
+
+// Every x86-64 processor but the very first ones has cmpxchg16b, the compiler
+// only needs -mcx16 to emit it by itself.
+OpenThreads::AtomicInt128 OpenThreads::AtomicCompareExchange128( AtomicInt128 volatile & rAtomic, AtomicInt128 value, AtomicInt128 compare )
+{
+    int64_t low = compare.low;
+    int64_t high = compare.high;
+
+    __asm__ __volatile__(
+        "lock cmpxchg16b %0"
+        : "+m"( *const_cast< AtomicInt128* >( &rAtomic ) ), "+a"( low ), "+d"( high )
+        : "b"( value.low ), "c"( value.high )
+        : "memory", "cc" );
+
+    AtomicInt128 result = { low, high };
+    return result;
+}
+
+bool OpenThreads::AtomicCompareExchange128IsLockFree()
+{
+    return true;
+}
+
+#else
+
+namespace {
+
+// Striped locks, so that unrelated variables rarely contend.
+const unsigned int NUM_ATOMIC128_LOCKS = 64;
+int32_t volatile s_atomic128Locks[NUM_ATOMIC128_LOCKS];
+
+}
+
+OpenThreads::AtomicInt128 OpenThreads::AtomicCompareExchange128( AtomicInt128 volatile & rAtomic, AtomicInt128 value, AtomicInt128 compare )
+{
+    int32_t volatile& lock = s_atomic128Locks[ ( reinterpret_cast< uintptr_t >( &rAtomic ) / sizeof(AtomicInt128) ) % NUM_ATOMIC128_LOCKS ];
+    while( AtomicExchange( lock, 1 ) != 0 )
+    {
+        while( lock != 0 ) SpinPause();
+    }
+
+    AtomicInt128 original;
+    original.low = rAtomic.low;
+    original.high = rAtomic.high;
+    if( original == compare )
+    {
+        rAtomic.low = value.low;
+        rAtomic.high = value.high;
+    }
+
+    AtomicExchange( lock, 0 );
+    return original;
+}
+
+bool OpenThreads::AtomicCompareExchange128IsLockFree()
+{
+    return false;
+}
+
+#endif
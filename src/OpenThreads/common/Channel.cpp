@@ -0,0 +1,386 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <OpenThreads/Channel.h>
+#include <OpenThreads/AtomicFunctions.h>
+#include <OpenThreads/Condition.h>
+#include <OpenThreads/Futex.h>
+#include <OpenThreads/ScopedLock.h>
+#include <algorithm>
+
+using namespace OpenThreads;
+
+namespace {
+
+// States of a waiter's parking record.  Only a thread that moves it from
+// WAITING to CLAIMED may complete one of its cases, or give it back to
+// WAITING if copying the value throws.
+enum WaiterState
+{
+    WAITER_WAITING,
+    WAITER_CLAIMED,
+    WAITER_DONE,
+    WAITER_TIMED_OUT
+};
+
+// selects with at most this many cases keep their bookkeeping on the stack
+const unsigned int STACK_CASES = 8;
+
+// varies the order in which select() tries its cases
+thread_local uint32_t t_selectSeed = 0;
+
+}
+
+//----------------------------------------------------------------------------
+// Parking record of a thread blocked in select(), shared by all its cases.
+//
+struct ChannelBase::Waiter
+{
+    int32_t volatile    state;
+    int                 selected;
+    bool                closed;
+};
+
+//----------------------------------------------------------------------------
+// One case of a blocked select(), linked into the queue of its channel.
+// Only touched with the lock of that channel held.
+//
+struct ChannelBase::WaitNode
+{
+    Waiter*     waiter;
+    int         index;
+    void*       value;
+    WaitNode*   previous;
+    WaitNode*   next;
+    bool        linked;
+};
+
+//----------------------------------------------------------------------------
+// Locks of the channels of a select(), sorted and without duplicates, held
+// until unlock() or the end of the scope.
+//
+struct ChannelBase::Locks
+{
+    Locks(ChannelBase** channels, unsigned int count) :
+        channels(channels),
+        count(count),
+        locked(false)
+    {
+        lock();
+    }
+
+    ~Locks()
+    {
+        if (locked) unlock();
+    }
+
+    void lock()
+    {
+        for(unsigned int i=0; i<count; ++i) channels[i]->_mutex.lock();
+        locked = true;
+    }
+
+    void unlock()
+    {
+        for(unsigned int i=count; i>0; --i) channels[i-1]->_mutex.unlock();
+        locked = false;
+    }
+
+    ChannelBase**   channels;
+    unsigned int    count;
+    bool            locked;
+};
+
+ChannelBase::ChannelBase(size_t capacity) :
+    _count(0),
+    _capacity(capacity),
+    _closed(false)
+{
+}
+
+ChannelBase::~ChannelBase()
+{
+}
+
+void ChannelBase::close()
+{
+    ScopedLock<Mutex> lock(_mutex);
+    if (_closed) return;
+    _closed = true;
+
+    while (WaitNode* node = dequeueClaimed(_receivers)) complete(node, true);
+    while (WaitNode* node = dequeueClaimed(_senders)) complete(node, true);
+}
+
+bool ChannelBase::isClosed() const
+{
+    ScopedLock<Mutex> lock(_mutex);
+    return _closed;
+}
+
+size_t ChannelBase::size() const
+{
+    ScopedLock<Mutex> lock(_mutex);
+    return _count;
+}
+
+ChannelBase::Result ChannelBase::sendLocked(const void* value)
+{
+    if (_closed) return CLOSED;
+
+    // a waiting receiver implies an empty buffer, hand the value over directly
+    if (WaitNode* receiver = dequeueClaimed(_receivers))
+    {
+        try
+        {
+            copyValue(receiver->value, value);
+        }
+        catch(...)
+        {
+            unclaim(_receivers, receiver);
+            throw;
+        }
+        complete(receiver, false);
+        return COMPLETED;
+    }
+
+    if (_count<_capacity)
+    {
+        pushValue(value);
+        ++_count;
+        return COMPLETED;
+    }
+    return NOT_READY;
+}
+
+ChannelBase::Result ChannelBase::receiveLocked(void* value)
+{
+    if (_count>0)
+    {
+        popValue(value);
+        --_count;
+
+        // refill the buffer from a waiting sender
+        if (WaitNode* sender = dequeueClaimed(_senders))
+        {
+            try
+            {
+                pushValue(sender->value);
+            }
+            catch(...)
+            {
+                // the receive is done, the sender waits on and the next receive tries again
+                unclaim(_senders, sender);
+                return COMPLETED;
+            }
+            ++_count;
+            complete(sender, false);
+        }
+        return COMPLETED;
+    }
+
+    if (WaitNode* sender = dequeueClaimed(_senders))
+    {
+        try
+        {
+            copyValue(value, sender->value);
+        }
+        catch(...)
+        {
+            unclaim(_senders, sender);
+            throw;
+        }
+        complete(sender, false);
+        return COMPLETED;
+    }
+
+    return _closed ? CLOSED : NOT_READY;
+}
+
+void ChannelBase::enqueue(WaitList& list, WaitNode* node)
+{
+    node->previous = list.last;
+    node->next = 0;
+    if (list.last) list.last->next = node;
+    else list.first = node;
+    list.last = node;
+    node->linked = true;
+}
+
+void ChannelBase::unlink(WaitList& list, WaitNode* node)
+{
+    if (node->previous) node->previous->next = node->next;
+    else list.first = node->next;
+    if (node->next) node->next->previous = node->previous;
+    else list.last = node->previous;
+    node->linked = false;
+}
+
+ChannelBase::WaitNode* ChannelBase::dequeueClaimed(WaitList& list)
+{
+    WaitNode* next;
+    for(WaitNode* node = list.first; node; node = next)
+    {
+        next = node->next;
+
+        int32_t state = AtomicCompareExchange(node->waiter->state, WAITER_CLAIMED, WAITER_WAITING);
+        if (state==WAITER_WAITING)
+        {
+            unlink(list, node);
+            return node;
+        }
+
+        // nodes of waiters completed by another channel, or timed out, are dropped.  A waiter claimed by another
+        // channel keeps its node, that channel gives the waiter back if copying the value throws.
+        if (state!=WAITER_CLAIMED) unlink(list, node);
+    }
+    return 0;
+}
+
+void ChannelBase::unclaim(WaitList& list, WaitNode* node)
+{
+    // back at the head of the queue, where dequeueClaimed() found it
+    node->previous = 0;
+    node->next = list.first;
+    if (list.first) list.first->previous = node;
+    else list.last = node;
+    list.first = node;
+    node->linked = true;
+
+    // the waiter may sleep without a timeout while it is claimed
+    AtomicExchange(node->waiter->state, WAITER_WAITING);
+    FutexWake(node->waiter->state, 1);
+}
+
+void ChannelBase::complete(WaitNode* node, bool closed)
+{
+    Waiter* waiter = node->waiter;
+    waiter->selected = node->index;
+    waiter->closed = closed;
+
+    // the waiter may return, and its record go away, as soon as it sees WAITER_DONE
+    AtomicExchange(waiter->state, WAITER_DONE);
+    FutexWake(waiter->state, 1);
+}
+
+int ChannelBase::select(const ChannelCase* cases, unsigned int count, bool block, const uint64_t* timeoutNs, bool& closed)
+{
+    closed = false;
+
+    WaitNode stackNodes[STACK_CASES];
+    ChannelBase* stackChannels[STACK_CASES];
+    std::vector<WaitNode> heapNodes;
+    std::vector<ChannelBase*> heapChannels;
+    WaitNode* nodes = stackNodes;
+    ChannelBase** channels = stackChannels;
+    if (count>STACK_CASES)
+    {
+        heapNodes.resize(count);
+        heapChannels.resize(count);
+        nodes = &heapNodes.front();
+        channels = &heapChannels.front();
+    }
+
+    // lock the channels in address order, so that concurrent selects cannot deadlock
+    for(unsigned int i=0; i<count; ++i) channels[i] = cases[i].channel;
+    std::sort(channels, channels + count);
+    unsigned int numChannels = static_cast<unsigned int>(std::unique(channels, channels + count) - channels);
+
+    Locks locks(channels, numChannels);
+
+    // complete a ready case right away
+    uint32_t seed = t_selectSeed * 1664525u + 1013904223u;
+    t_selectSeed = seed;
+    unsigned int start = count ? (seed >> 16) % count : 0;
+    for(unsigned int n=0; n<count; ++n)
+    {
+        unsigned int i = (start + n) % count;
+        ChannelBase* channel = cases[i].channel;
+        Result result = cases[i].send ? channel->sendLocked(cases[i].value) : channel->receiveLocked(cases[i].value);
+        if (result!=NOT_READY)
+        {
+            locks.unlock();
+            closed = result==CLOSED;
+            return static_cast<int>(i);
+        }
+    }
+
+    if (!block)
+    {
+        locks.unlock();
+        return SELECT_WOULD_BLOCK;
+    }
+
+    // park, with one node per case in the queues of the channels
+    Waiter waiter;
+    waiter.state = WAITER_WAITING;
+    waiter.selected = SELECT_TIMEOUT;
+    waiter.closed = false;
+
+    for(unsigned int i=0; i<count; ++i)
+    {
+        WaitNode& node = nodes[i];
+        node.waiter = &waiter;
+        node.index = static_cast<int>(i);
+        node.value = cases[i].value;
+        enqueue(cases[i].send ? cases[i].channel->_senders : cases[i].channel->_receivers, &node);
+    }
+
+    locks.unlock();
+
+    uint64_t deadline = timeoutNs ? Condition::getMonotonicTime() + *timeoutNs : 0;
+    bool timedOut = false;
+    for(;;)
+    {
+        int32_t state = waiter.state;
+        if (state==WAITER_DONE) break;
+
+        if (timeoutNs && state==WAITER_WAITING)
+        {
+            uint64_t now = Condition::getMonotonicTime();
+            if (now>=deadline)
+            {
+                // withdraw, unless a channel claimed us meanwhile and is completing a case
+                if (AtomicCompareExchange(waiter.state, WAITER_TIMED_OUT, WAITER_WAITING)==WAITER_WAITING)
+                {
+                    timedOut = true;
+                    break;
+                }
+                continue;
+            }
+            FutexWait(waiter.state, state, deadline - now);
+        }
+        else
+        {
+            FutexWait(waiter.state, state);
+        }
+    }
+
+    // the completing channel has dropped its node, take ours out of the other queues
+    if (count>1 || timedOut)
+    {
+        locks.lock();
+        for(unsigned int i=0; i<count; ++i)
+        {
+            if (nodes[i].linked) unlink(cases[i].send ? cases[i].channel->_senders : cases[i].channel->_receivers, &nodes[i]);
+        }
+        locks.unlock();
+    }
+
+    // see the values written by the completing thread
+    AtomicThreadFenceAcquire();
+
+    if (timedOut) return SELECT_TIMEOUT;
+    closed = waiter.closed;
+    return waiter.selected;
+}
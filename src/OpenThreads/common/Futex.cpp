@@ -0,0 +1,144 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <OpenThreads/Futex.h>
+#include <errno.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#else
+#include <OpenThreads/Mutex.h>
+#include <OpenThreads/Condition.h>
+#include <OpenThreads/ScopedLock.h>
+#endif
+
+using namespace OpenThreads;
+
+#if defined(__linux__)
+
+// The futex words are never shared between processes, so the private
+// variants save the kernel a lookup of the backing page.
+#ifndef FUTEX_WAIT_PRIVATE
+#define FUTEX_WAIT_PRIVATE FUTEX_WAIT
+#define FUTEX_WAKE_PRIVATE FUTEX_WAKE
+#endif
+
+static inline long sys_futex(int32_t volatile* addr, int op, int32_t val, const struct timespec* timeout)
+{
+    return syscall(SYS_futex, const_cast<int32_t*>(addr), op, val, timeout, NULL, 0);
+}
+
+int OpenThreads::FutexWait( int32_t volatile & rAtomic, int32_t expected )
+{
+    sys_futex(&rAtomic, FUTEX_WAIT_PRIVATE, expected, NULL);
+    return 0;
+}
+
+int OpenThreads::FutexWait( int32_t volatile & rAtomic, int32_t expected, uint64_t timeoutNs )
+{
+    // FUTEX_WAIT takes a relative timeout measured against CLOCK_MONOTONIC.
+    struct timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(timeoutNs / 1000000000u);
+    timeout.tv_nsec = static_cast<long>(timeoutNs % 1000000000u);
+
+    if (sys_futex(&rAtomic, FUTEX_WAIT_PRIVATE, expected, &timeout) == -1 && errno == ETIMEDOUT)
+        return ETIMEDOUT;
+    return 0;
+}
+
+int OpenThreads::FutexWake( int32_t volatile & rAtomic, int32_t count )
+{
+    return sys_futex(&rAtomic, FUTEX_WAKE_PRIVATE, count, NULL) == -1 ? -1 : 0;
+}
+
+int OpenThreads::FutexWakeAll( int32_t volatile & rAtomic )
+{
+    return FutexWake(rAtomic, INT_MAX);
+}
+
+#else
+
+//----------------------------------------------------------------------------
+// Without kernel support the waiters are parked on a small table of
+// Mutex/Condition pairs, selected by hashing the address of the word.
+// Wake-ups are broadcast to the whole bucket, which is allowed since
+// FutexWait() may return spuriously.
+//
+namespace {
+
+struct ParkingBucket
+{
+    ParkingBucket() : waiters(0) {}
+
+    Mutex mutex;
+    Condition condition;
+    unsigned int waiters;
+};
+
+const unsigned int NUM_PARKING_BUCKETS = 64;
+
+ParkingBucket& getParkingBucket(int32_t volatile* addr)
+{
+    static ParkingBucket s_buckets[NUM_PARKING_BUCKETS];
+
+    size_t key = reinterpret_cast<size_t>(addr);
+    key ^= key >> 9;
+    return s_buckets[(key >> 2) % NUM_PARKING_BUCKETS];
+}
+
+int parkingWait(int32_t volatile* addr, int32_t expected, unsigned long ms, bool timed)
+{
+    ParkingBucket& bucket = getParkingBucket(addr);
+
+    ScopedLock<Mutex> lock(bucket.mutex);
+    if (*addr != expected)
+        return 0;
+
+    ++bucket.waiters;
+    int status = timed ? bucket.condition.wait(&bucket.mutex, ms) : bucket.condition.wait(&bucket.mutex);
+    --bucket.waiters;
+
+    return (timed && status != 0) ? ETIMEDOUT : 0;
+}
+
+}
+
+int OpenThreads::FutexWait( int32_t volatile & rAtomic, int32_t expected )
+{
+    return parkingWait(&rAtomic, expected, 0, false);
+}
+
+int OpenThreads::FutexWait( int32_t volatile & rAtomic, int32_t expected, uint64_t timeoutNs )
+{
+    // round up, a zero timeout would turn into a busy loop in the callers
+    return parkingWait(&rAtomic, expected, static_cast<unsigned long>((timeoutNs + 999999u) / 1000000u), true);
+}
+
+int OpenThreads::FutexWake( int32_t volatile & rAtomic, int32_t /*count*/ )
+{
+    ParkingBucket& bucket = getParkingBucket(&rAtomic);
+
+    ScopedLock<Mutex> lock(bucket.mutex);
+    return bucket.waiters ? bucket.condition.broadcast() : 0;
+}
+
+int OpenThreads::FutexWakeAll( int32_t volatile & rAtomic )
+{
+    return FutexWake(rAtomic, 0);
+}
+
+#endif
@@ -0,0 +1,288 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <OpenThreads/HazardPointer.h>
+#include <OpenThreads/CacheAlignedArray.h>
+#include <OpenThreads/ScopedLock.h>
+#include <algorithm>
+#include <vector>
+
+using namespace OpenThreads;
+
+namespace {
+
+struct Retired
+{
+    void* object;
+    HazardPointerDomain::Deleter deleter;
+};
+
+typedef std::vector<Retired> RetiredList;
+
+// never scan for fewer retired objects than this, whatever the number of records
+const size_t MIN_RECLAIM_BATCH = 64;
+
+}
+
+namespace OpenThreads {
+
+//----------------------------------------------------------------------------
+// Per-thread part of every domain the thread has used: the records it owns
+// and the objects it retired.  Destroyed, and handed back to the domains,
+// when the thread exits.
+//
+class HazardPointerThreadState
+{
+public:
+
+    struct DomainData
+    {
+        HazardPointerDomain* domain;
+        std::vector<HazardPointerDomain::Record*> records;
+        RetiredList retired;
+    };
+
+    HazardPointerThreadState() : _last(0) {}
+
+    ~HazardPointerThreadState();
+
+    DomainData* get(HazardPointerDomain* domain)
+    {
+        if (_last && _last->domain==domain) return _last;
+
+        for(std::vector<DomainData*>::iterator itr = _domains.begin(); itr!=_domains.end(); ++itr)
+        {
+            if ((*itr)->domain==domain) return _last = *itr;
+        }
+
+        DomainData* data = new DomainData;
+        data->domain = domain;
+        _domains.push_back(data);
+        return _last = data;
+    }
+
+    void remove(HazardPointerDomain* domain)
+    {
+        for(std::vector<DomainData*>::iterator itr = _domains.begin(); itr!=_domains.end(); ++itr)
+        {
+            if ((*itr)->domain==domain)
+            {
+                detach(*itr);
+                delete *itr;
+                _domains.erase(itr);
+                _last = 0;
+                return;
+            }
+        }
+    }
+
+    static void scan(HazardPointerDomain& domain, RetiredList& retired);
+
+    static void detach(DomainData* data);
+
+private:
+
+    std::vector<DomainData*> _domains;
+    DomainData* _last;
+};
+
+}
+
+namespace {
+
+thread_local HazardPointerThreadState t_hazardPointerState;
+
+// set once t_hazardPointerState is gone, the domains then fall back to
+// their shared lists for the rest of the thread's life.
+thread_local bool t_hazardPointerStateDestroyed = false;
+
+HazardPointerThreadState::DomainData* getThreadData(HazardPointerDomain* domain)
+{
+    return t_hazardPointerStateDestroyed ? 0 : t_hazardPointerState.get(domain);
+}
+
+}
+
+HazardPointerThreadState::~HazardPointerThreadState()
+{
+    t_hazardPointerStateDestroyed = true;
+
+    for(std::vector<DomainData*>::iterator itr = _domains.begin(); itr!=_domains.end(); ++itr)
+    {
+        detach(*itr);
+        delete *itr;
+    }
+}
+
+void HazardPointerThreadState::scan(HazardPointerDomain& domain, RetiredList& retired)
+{
+    if (domain._numOrphans!=0)
+    {
+        ScopedLock<Mutex> lock(domain._orphanMutex);
+        RetiredList* orphans = static_cast<RetiredList*>(domain._orphans);
+        retired.insert(retired.end(), orphans->begin(), orphans->end());
+        orphans->clear();
+        domain._numOrphans = 0;
+    }
+
+    // pairs with the full barrier in HazardPointer::tryProtect(): either the
+    // reader sees the object unlinked, or we see its hazard.
+    AtomicThreadFence();
+
+    std::vector<void*> hazards;
+    for(HazardPointerDomain::Record* record = domain._records; record; record = record->next)
+    {
+        void* pointer = record->pointer;
+        if (pointer) hazards.push_back(pointer);
+    }
+    std::sort(hazards.begin(), hazards.end());
+
+    // deleters may retire more objects, so work on a private copy
+    RetiredList candidates;
+    candidates.swap(retired);
+
+    for(RetiredList::iterator itr = candidates.begin(); itr!=candidates.end(); ++itr)
+    {
+        if (std::binary_search(hazards.begin(), hazards.end(), itr->object)) retired.push_back(*itr);
+        else itr->deleter(itr->object);
+    }
+}
+
+void HazardPointerThreadState::detach(DomainData* data)
+{
+    HazardPointerDomain& domain = *data->domain;
+
+    for(std::vector<HazardPointerDomain::Record*>::iterator itr = data->records.begin(); itr!=data->records.end(); ++itr)
+    {
+        AtomicExchange((*itr)->active, 0);
+    }
+    data->records.clear();
+
+    if (!data->retired.empty()) scan(domain, data->retired);
+
+    if (!data->retired.empty())
+    {
+        ScopedLock<Mutex> lock(domain._orphanMutex);
+        RetiredList* orphans = static_cast<RetiredList*>(domain._orphans);
+        orphans->insert(orphans->end(), data->retired.begin(), data->retired.end());
+        domain._numOrphans = static_cast<int32_t>(orphans->size());
+        data->retired.clear();
+    }
+}
+
+//----------------------------------------------------------------------------
+//
+// HazardPointerDomain
+//
+HazardPointerDomain::HazardPointerDomain() :
+    _records(0),
+    _numRecords(0),
+    _orphans(new RetiredList),
+    _numOrphans(0)
+{
+}
+
+HazardPointerDomain::~HazardPointerDomain()
+{
+    if (!t_hazardPointerStateDestroyed) t_hazardPointerState.remove(this);
+
+    RetiredList* orphans = static_cast<RetiredList*>(_orphans);
+    for(RetiredList::iterator itr = orphans->begin(); itr!=orphans->end(); ++itr)
+    {
+        itr->deleter(itr->object);
+    }
+    delete orphans;
+
+    for(Record* record = _records; record;)
+    {
+        Record* next = record->next;
+        DeallocateAligned(record, alignof(Record));
+        record = next;
+    }
+}
+
+HazardPointerDomain& HazardPointerDomain::getDefault()
+{
+    static HazardPointerDomain s_domain;
+    return s_domain;
+}
+
+void HazardPointerDomain::retire(void* object, Deleter deleter)
+{
+    Retired retired = { object, deleter };
+
+    HazardPointerThreadState::DomainData* data = getThreadData(this);
+    if (!data)
+    {
+        ScopedLock<Mutex> lock(_orphanMutex);
+        RetiredList* orphans = static_cast<RetiredList*>(_orphans);
+        orphans->push_back(retired);
+        _numOrphans = static_cast<int32_t>(orphans->size());
+        return;
+    }
+
+    data->retired.push_back(retired);
+
+    size_t batch = 2 * static_cast<size_t>(_numRecords);
+    if (data->retired.size() >= std::max(batch, MIN_RECLAIM_BATCH))
+    {
+        HazardPointerThreadState::scan(*this, data->retired);
+    }
+}
+
+void HazardPointerDomain::reclaim()
+{
+    HazardPointerThreadState::DomainData* data = getThreadData(this);
+    if (data) HazardPointerThreadState::scan(*this, data->retired);
+}
+
+HazardPointerDomain::Record* HazardPointerDomain::acquireRecord()
+{
+    HazardPointerThreadState::DomainData* data = getThreadData(this);
+    if (data && !data->records.empty())
+    {
+        Record* record = data->records.back();
+        data->records.pop_back();
+        return record;
+    }
+
+    // take over a record given back by an exited thread
+    for(Record* record = _records; record; record = record->next)
+    {
+        if (record->active==0 && AtomicCompareExchange(record->active, 1, 0)==0) return record;
+    }
+
+    Record* record = new (AllocateAligned(sizeof(Record), alignof(Record))) Record;
+    record->pointer = 0;
+    record->active = 1;
+
+    Record* head;
+    do
+    {
+        head = _records;
+        record->next = head;
+    }
+    while (AtomicCompareExchange(_records, record, head)!=head);
+
+    AtomicIncrement(_numRecords);
+    return record;
+}
+
+void HazardPointerDomain::releaseRecord(Record* record)
+{
+    AtomicExchangePointerRelease(record->pointer, 0);
+
+    HazardPointerThreadState::DomainData* data = getThreadData(this);
+    if (data) data->records.push_back(record);
+    else AtomicExchange(record->active, 0);
+}
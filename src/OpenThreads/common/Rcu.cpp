@@ -0,0 +1,355 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <OpenThreads/Rcu.h>
+#include <OpenThreads/CacheAlignedArray.h>
+#include <OpenThreads/Thread.h>
+#include <OpenThreads/Condition.h>
+#include <OpenThreads/ScopedLock.h>
+#include <vector>
+#include <utility>
+
+using namespace OpenThreads;
+
+namespace OpenThreads {
+
+//----------------------------------------------------------------------------
+// Epoch slots of the calling thread, one per domain it has used.  Given back
+// to the domains when the thread exits.
+//
+class RcuThreadState
+{
+public:
+
+    typedef std::pair<RcuDomain*, RcuDomain::Record*> Entry;
+
+    RcuThreadState() : _lastDomain(0), _lastRecord(0) {}
+
+    ~RcuThreadState();
+
+    RcuDomain::Record* get(RcuDomain* domain)
+    {
+        if (_lastDomain==domain) return _lastRecord;
+
+        RcuDomain::Record* record = 0;
+        for(std::vector<Entry>::iterator itr = _entries.begin(); itr!=_entries.end() && !record; ++itr)
+        {
+            if (itr->first==domain) record = itr->second;
+        }
+
+        if (!record)
+        {
+            record = acquire(domain);
+            _entries.push_back(Entry(domain, record));
+        }
+
+        _lastDomain = domain;
+        _lastRecord = record;
+        return record;
+    }
+
+    void remove(RcuDomain* domain)
+    {
+        for(std::vector<Entry>::iterator itr = _entries.begin(); itr!=_entries.end(); ++itr)
+        {
+            if (itr->first==domain)
+            {
+                release(itr->second);
+                _entries.erase(itr);
+                _lastDomain = 0;
+                _lastRecord = 0;
+                return;
+            }
+        }
+    }
+
+    static RcuDomain::Record* acquire(RcuDomain* domain);
+
+    static void release(RcuDomain::Record* record)
+    {
+        record->nesting = 0;
+        AtomicExchange(record->epoch, 0);
+        AtomicExchange(record->active, 0);
+    }
+
+private:
+
+    std::vector<Entry> _entries;
+    RcuDomain* _lastDomain;
+    RcuDomain::Record* _lastRecord;
+};
+
+//----------------------------------------------------------------------------
+// Runs the callbacks queued with callRcu(), one grace period per batch.
+//
+class RcuCallbackThread : public Thread
+{
+public:
+
+    typedef std::pair<RcuDomain::Callback, void*> Callback;
+    typedef std::vector<Callback> Callbacks;
+
+    RcuCallbackThread(RcuDomain* domain) :
+        _domain(domain),
+        _stopping(false),
+        _started(false),
+        _queued(0),
+        _completed(0) {}
+
+    virtual void run()
+    {
+        _domain->processCallbacks();
+    }
+
+    RcuDomain* _domain;
+
+    Mutex _mutex;
+    Condition _workCondition;
+    Condition _doneCondition;
+
+    Callbacks _pending;
+    bool _stopping;
+    bool _started;
+    uint64_t _queued;
+    uint64_t _completed;
+};
+
+}
+
+namespace {
+
+thread_local RcuThreadState t_rcuState;
+
+// set once t_rcuState is gone, read-side sections the thread still runs
+// afterwards (from other thread_local destructors) use a slot of its own.
+thread_local bool t_rcuStateDestroyed = false;
+thread_local RcuDomain* t_rcuFallbackDomain = 0;
+thread_local RcuDomain::Record* t_rcuFallbackRecord = 0;
+
+// Wait politely for a reader, most read-side sections are short.
+inline void rcuBackoff(unsigned int& spins)
+{
+    if (++spins < 128) SpinPause();
+    else if (spins < 256) Thread::YieldCurrentThread();
+    else Thread::microSleep(100);
+}
+
+}
+
+RcuThreadState::~RcuThreadState()
+{
+    t_rcuStateDestroyed = true;
+
+    for(std::vector<Entry>::iterator itr = _entries.begin(); itr!=_entries.end(); ++itr)
+    {
+        release(itr->second);
+    }
+}
+
+RcuDomain::Record* RcuThreadState::acquire(RcuDomain* domain)
+{
+    // take over the slot of an exited thread
+    for(RcuDomain::Record* record = domain->_records; record; record = record->next)
+    {
+        if (record->active==0 && AtomicCompareExchange(record->active, 1, 0)==0) return record;
+    }
+
+    RcuDomain::Record* record = new (AllocateAligned(sizeof(RcuDomain::Record), alignof(RcuDomain::Record))) RcuDomain::Record;
+    record->epoch = 0;
+    record->active = 1;
+    record->nesting = 0;
+
+    RcuDomain::Record* head;
+    do
+    {
+        head = domain->_records;
+        record->next = head;
+    }
+    while (AtomicCompareExchange(domain->_records, record, head)!=head);
+
+    return record;
+}
+
+//----------------------------------------------------------------------------
+//
+// RcuDomain
+//
+RcuDomain::RcuDomain() :
+    _records(0),
+    _epoch(1),
+    _callbacks(new RcuCallbackThread(this))
+{
+}
+
+RcuDomain::~RcuDomain()
+{
+    RcuCallbackThread* thread = static_cast<RcuCallbackThread*>(_callbacks);
+
+    bool started;
+    {
+        ScopedLock<Mutex> lock(thread->_mutex);
+        thread->_stopping = true;
+        started = thread->_started;
+        thread->_workCondition.signal();
+    }
+    if (started) thread->join();
+
+    // the thread has drained the queue, unless it was never started
+    if (!thread->_pending.empty())
+    {
+        synchronize();
+        for(RcuCallbackThread::Callbacks::iterator itr = thread->_pending.begin(); itr!=thread->_pending.end(); ++itr)
+        {
+            itr->first(itr->second);
+        }
+    }
+    delete thread;
+
+    if (!t_rcuStateDestroyed) t_rcuState.remove(this);
+
+    for(Record* record = _records; record;)
+    {
+        Record* next = record->next;
+        DeallocateAligned(record, alignof(Record));
+        record = next;
+    }
+}
+
+RcuDomain& RcuDomain::getDefault()
+{
+    static RcuDomain s_domain;
+    return s_domain;
+}
+
+RcuDomain::Record* RcuDomain::getRecord()
+{
+    if (!t_rcuStateDestroyed) return t_rcuState.get(this);
+
+    if (t_rcuFallbackDomain!=this)
+    {
+        t_rcuFallbackDomain = this;
+        t_rcuFallbackRecord = RcuThreadState::acquire(this);
+    }
+    return t_rcuFallbackRecord;
+}
+
+void RcuDomain::readLock()
+{
+    Record* record = getRecord();
+    if (record->nesting++ == 0)
+    {
+        record->epoch = _epoch;
+
+        // full barrier: synchronize() sees our epoch, or we see the new data
+        AtomicThreadFence();
+    }
+}
+
+void RcuDomain::readUnlock()
+{
+    Record* record = getRecord();
+    if (--record->nesting == 0)
+    {
+        AtomicThreadFenceRelease();
+        record->epoch = 0;
+    }
+}
+
+void RcuDomain::synchronize()
+{
+    ScopedLock<Mutex> lock(_synchronizeMutex);
+
+    // Epochs are odd, so they never match the idle value 0.  Readers that
+    // entered before the increment hold an older epoch and are waited for.
+    int32_t epoch = AtomicAdd(_epoch, 2) + 2;
+
+    for(Record* record = _records; record; record = record->next)
+    {
+        unsigned int spins = 0;
+        for(;;)
+        {
+            int32_t readerEpoch = record->epoch;
+            if (readerEpoch==0 || static_cast<int32_t>(readerEpoch - epoch)>=0) break;
+            rcuBackoff(spins);
+        }
+    }
+
+    // order the caller's following frees after the epoch reads
+    AtomicThreadFence();
+}
+
+void RcuDomain::callRcu(Callback callback, void* data)
+{
+    RcuCallbackThread* thread = static_cast<RcuCallbackThread*>(_callbacks);
+
+    ScopedLock<Mutex> lock(thread->_mutex);
+    thread->_pending.push_back(RcuCallbackThread::Callback(callback, data));
+    ++thread->_queued;
+
+    if (!thread->_started)
+    {
+        thread->_started = true;
+        thread->start();
+    }
+    else if (thread->_pending.size()==1)
+    {
+        thread->_workCondition.signal();
+    }
+}
+
+void RcuDomain::barrier()
+{
+    RcuCallbackThread* thread = static_cast<RcuCallbackThread*>(_callbacks);
+
+    ScopedLock<Mutex> lock(thread->_mutex);
+    uint64_t target = thread->_queued;
+    while (thread->_completed < target)
+    {
+        thread->_doneCondition.wait(&thread->_mutex);
+    }
+}
+
+void RcuDomain::processCallbacks()
+{
+    RcuCallbackThread* thread = static_cast<RcuCallbackThread*>(_callbacks);
+    RcuCallbackThread::Callbacks batch;
+
+    for(;;)
+    {
+        {
+            ScopedLock<Mutex> lock(thread->_mutex);
+            while (thread->_pending.empty() && !thread->_stopping)
+            {
+                thread->_workCondition.wait(&thread->_mutex);
+            }
+            if (thread->_pending.empty()) return;
+
+            batch.swap(thread->_pending);
+        }
+
+        // one grace period for the whole batch
+        synchronize();
+
+        for(RcuCallbackThread::Callbacks::iterator itr = batch.begin(); itr!=batch.end(); ++itr)
+        {
+            itr->first(itr->second);
+        }
+
+        {
+            ScopedLock<Mutex> lock(thread->_mutex);
+            thread->_completed += batch.size();
+            thread->_doneCondition.broadcast();
+        }
+        batch.clear();
+    }
+}
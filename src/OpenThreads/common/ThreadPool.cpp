@@ -15,13 +15,12 @@
 */
 
 #include <OpenThreads/ThreadPool.h>
-#include <OpenThreads/ScopedLock>
+#include <OpenThreads/ScopedLock.h>
 #include <algorithm>
 #include <assert.h>
 //#include <iostream>
 using namespace OpenThreads;
 
-
 TaskContext::TaskContext()
 	: _pool(nullptr), _worker(nullptr)
 {
@@ -44,6 +43,7 @@ bool TaskContext::shouldStop(bool isSafeCancelPoint)
 }
 
 Task::Task()
+	: _queued(0)
 {
 }
 
@@ -87,35 +87,18 @@ void WorkerThread::run()
 
 	init();
 
+	while (!shouldStop())
 	{
-		ScopedLock<Mutex> slock(_mutex);
-		while (!shouldStop())
+		// waiting for a task is not a cancellation point, cancel() queues
+		// a wake-up task so that shouldStop() tests for it
+		Task* task = _tasks.pop();
+		if (task != &_wakeUpTask && task != &_cancelWakeUpTask)
 		{
-			while (_tasks.empty())
-				_condition.wait(&_mutex);
-
-			if (shouldStop())
-				break;
-
-			if (_tasks.size() == 1 && *(_tasks.begin()) == nullptr) 
-			{
-				// Take a shortcut if we're only performing a no-op
-				_tasks.clear();
-			}
-			else
-			{
-				Tasks copy = _tasks;
-				_tasks.clear();
-
-				{
-					ReverseScopedLock<Mutex> sunlock(_mutex);
-					for (Tasks::iterator it = copy.begin(); it != copy.end(); ++it)
-					{
-						if (*it != nullptr)
-							executeTask(*it);
-					}
-				}
-			}
+#ifndef NDEBUG
+			AtomicExchangeRelease(task->_queued, 0);
+#endif
+			executeTask(task);
+			task->completed();
 		}
 	}
 }
@@ -127,18 +110,36 @@ void WorkerThread::executeTask(Task* task)
 
 void WorkerThread::queue(Task* task)
 {
-	ScopedLock<Mutex> slock(_mutex);
-	_tasks.push_back(task);
-	//std::cout << "queued " << _tasks.size() << "th task" << std::endl;
-	_condition.signal();
+	if (task != nullptr)
+	{
+#ifndef NDEBUG
+		int32_t wasQueued = AtomicExchange(task->_queued, 1);
+		assert(wasQueued == 0 && "task queued again before a worker took it");
+		(void)wasQueued;
+#endif
+		_tasks.push(task);
+	}
 }
 
 void WorkerThread::stop(bool finishTasks)
 {
-	ScopedLock<Mutex> slock(_mutex);
-	_flags |= STOPPING | (finishTasks ? STOP_AFTER_TASKS : 0);
-	_tasks.push_back(nullptr);
-	_condition.signal();
+	int32_t previous = AtomicOr(_flags, STOPPING | (finishTasks ? STOP_AFTER_TASKS : 0));
+
+	// the wake-up task can only be queued once
+	if ((previous & STOPPING) == 0)
+		_tasks.push(&_wakeUpTask);
+}
+
+int WorkerThread::cancel()
+{
+	int ret = Thread::cancel();
+
+	// the cancel request is set before the worker wakes up to test it
+	int32_t previous = AtomicOr(_flags, CANCELLING);
+	if ((previous & CANCELLING) == 0)
+		_tasks.push(&_cancelWakeUpTask);
+
+	return ret;
 }
 
 bool WorkerThread::shouldStop()
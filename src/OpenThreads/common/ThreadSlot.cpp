@@ -0,0 +1,40 @@
+/* -*-c++-*- OpenThreads library, Copyright (C) 2002 - 2007  The Open Thread Group
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <OpenThreads/Thread.h>
+#include <OpenThreads/AtomicFunctions.h>
+
+// Visual Studio only knows about thread_local since 2015
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define OPENTHREADS_THREAD_LOCAL __declspec(thread)
+#else
+#define OPENTHREADS_THREAD_LOCAL thread_local
+#endif
+
+namespace {
+
+int32_t volatile s_nextThreadSlot = 0;
+
+// 0 until the thread asked for its slot, slot + 1 afterwards
+OPENTHREADS_THREAD_LOCAL unsigned int t_threadSlot = 0;
+
+}
+
+unsigned int OpenThreads::GetCurrentThreadSlot()
+{
+    if (t_threadSlot == 0)
+    {
+        t_threadSlot = static_cast<unsigned int>(AtomicIncrement(s_nextThreadSlot));
+    }
+    return t_threadSlot - 1;
+}
@@ -53,6 +53,7 @@
 #endif
 
 #include <OpenThreads/Thread.h>
+#include <OpenThreads/Arena.h>
 #include "PThreadPrivateData.h"
 
 #include <iostream>
@@ -97,6 +98,7 @@ void thread_cleanup_handler(void *arg)
     ThreadCleanupStruct *tcs = static_cast<ThreadCleanupStruct *>(arg);
 
     tcs->thread->cancelCleanup();
+    ThreadLocalArena::release();
     (*(tcs->runflag)).exchange(0);
 
 }
@@ -203,6 +205,8 @@ private:
 
         thread->run();
 
+        ThreadLocalArena::release();
+
         pd->setRunning(false);
 
         pthread_cleanup_pop(0);
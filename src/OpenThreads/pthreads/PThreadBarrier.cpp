@@ -20,6 +20,9 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <OpenThreads/Barrier.h>
+#include <OpenThreads/Thread.h>
+#include <OpenThreads/AtomicFunctions.h>
+#include <OpenThreads/Futex.h>
 #include "PThreadBarrierPrivateData.h"
 
 using namespace OpenThreads;
@@ -37,13 +40,60 @@ void barrier_cleanup_handler(void *arg) {
 
 }
 
+//----------------------------------------------------------------------------
+// BARRIER_SPIN and BARRIER_HYBRID: a sense-reversing barrier.  Arrivals are
+// counted with one atomic increment, the last thread in resets the count and
+// flips the sense word that the others are watching.  Hybrid waiters stop
+// spinning after a while and sleep on the sense word instead.
+//
+void PThreadBarrierPrivateData::spinRelease()
+{
+    AtomicExchange(arrived, 0);
+    AtomicXor(sense, 1);
+    if (sleepers != 0) FutexWakeAll(sense);
+}
+
+void PThreadBarrierPrivateData::spinBlock(bool hybrid)
+{
+    // the sense can't flip before we have arrived, so read it first
+    int32_t my_sense = sense;
+
+    if (AtomicIncrement(arrived) >= maxcnt)  // I am the last one
+    {
+        spinRelease();
+        return;
+    }
+
+    unsigned int spins = 0;
+    while (sense == my_sense)
+    {
+        if (hybrid && spins >= spinCount)
+        {
+            AtomicIncrement(sleepers);
+            FutexWait(sense, my_sense);
+            AtomicDecrement(sleepers);
+        }
+        else if ((++spins & 1023) == 0)
+        {
+            // don't starve whoever we are waiting for when the
+            // machine has more threads than processors.
+            Thread::YieldCurrentThread();
+        }
+        else
+        {
+            SpinPause();
+        }
+    }
+}
+
 //----------------------------------------------------------------------------
 //
 // Description: Constructor
 //
 // Use: public.
 //
-Barrier::Barrier(int numThreads) {
+Barrier::Barrier(int numThreads, BarrierType type) :
+    _barrierType(type) {
 
     PThreadBarrierPrivateData *pd = new PThreadBarrierPrivateData();
 
@@ -51,6 +101,12 @@ Barrier::Barrier(int numThreads) {
     pd->phase = 0;
     pd->maxcnt = numThreads;
 
+    pd->arrived = 0;
+    pd->sense = 0;
+    pd->sleepers = 0;
+    // spinning is pointless if the thread we wait for can't run meanwhile
+    pd->spinCount = GetNumberOfProcessors() > 1 ? 4000 : 0;
+
     _valid = true;
 
     pthread_mutexattr_t mutex_attr;
@@ -145,6 +201,7 @@ void Barrier::reset() {
 
     pd->cnt = 0;
     pd->phase = 0;
+    pd->arrived = 0;
 
 }
 
@@ -161,6 +218,12 @@ void Barrier::block(unsigned int numThreads) {
 
     if(numThreads != 0) pd->maxcnt = numThreads;
 
+    if (_barrierType != BARRIER_BLOCKING)
+    {
+        if (_valid) pd->spinBlock(_barrierType == BARRIER_HYBRID);
+        return;
+    }
+
     int my_phase;
 
     pthread_mutex_lock(&(pd->lock));
@@ -212,6 +275,12 @@ void Barrier::release() {
     PThreadBarrierPrivateData *pd =
         static_cast<PThreadBarrierPrivateData*>(_prvData);
 
+    if (_barrierType != BARRIER_BLOCKING)
+    {
+        pd->spinRelease();
+        return;
+    }
+
     int my_phase;
 
     pthread_mutex_lock(&(pd->lock));
@@ -234,6 +303,7 @@ int Barrier::numThreadsCurrentlyBlocked() {
     
     PThreadBarrierPrivateData *pd = static_cast<PThreadBarrierPrivateData*>(_prvData);
     
+    if (_barrierType != BARRIER_BLOCKING) return pd->arrived;
     
     int numBlocked = -1;
     pthread_mutex_lock(&(pd->lock));
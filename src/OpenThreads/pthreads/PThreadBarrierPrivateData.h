@@ -21,6 +21,7 @@
 #define _PTHREADBARRIERPRIVATEDATA_H_
 
 #include <pthread.h>
+#include <stdint.h>
 #include <OpenThreads/Barrier.h>
 
 namespace OpenThreads {
@@ -35,6 +36,10 @@ private:
     
     virtual ~PThreadBarrierPrivateData() {};
 
+    void spinBlock(bool hybrid);
+
+    void spinRelease();
+
     pthread_cond_t     cond;            // cv for waiters at barrier
 
     pthread_mutex_t    lock;            // mutex for waiters at barrier
@@ -45,6 +50,13 @@ private:
 
     volatile int       phase;           // flag to seperate two barriers
 
+    // state of the BARRIER_SPIN and BARRIER_HYBRID barriers, which do
+    // not use the mutex/condition pair.
+    int32_t volatile   arrived;         // number of threads that reached the barrier
+    int32_t volatile   sense;           // flipped by the last thread to release the others
+    int32_t volatile   sleepers;        // number of threads sleeping on sense
+    unsigned int       spinCount;       // spins before a BARRIER_HYBRID waiter sleeps
+
 };
 
 }
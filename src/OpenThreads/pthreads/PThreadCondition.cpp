@@ -26,13 +26,23 @@
 #include <stdio.h>
 
 #include <OpenThreads/Condition.h>
+#include <OpenThreads/AtomicFunctions.h>
+#include <OpenThreads/Futex.h>
 #include "PThreadConditionPrivateData.h"
 #include "PThreadMutexPrivateData.h"
 
 #include <errno.h>
+#include <time.h>
 
 using namespace OpenThreads;
 
+// Timed waits are measured against CLOCK_MONOTONIC wherever the condition
+// variable can be told to use it, so that steps of the system clock don't
+// stretch or cut short a timeout.
+#if defined(HAVE_PTHREAD_CONDATTR_SETCLOCK) && defined(CLOCK_MONOTONIC)
+#define OT_CONDITION_MONOTONIC_CLOCK
+#endif
+
 #if defined(_MSC_VER) || defined(__MINGW32__)
 int gettimeofday(struct timeval* tp, void* tzp) {
     LARGE_INTEGER t;
@@ -87,12 +97,21 @@ Condition::Condition() {
     PThreadConditionPrivateData *pd =
         new PThreadConditionPrivateData();
 
-    int status = pthread_cond_init( &pd->condition, NULL );
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init( &cond_attr );
+
+#ifdef OT_CONDITION_MONOTONIC_CLOCK
+    pthread_condattr_setclock( &cond_attr, CLOCK_MONOTONIC );
+#endif
+
+    int status = pthread_cond_init( &pd->condition, &cond_attr );
     if (status)
     {
         printf("Error: pthread_cond_init(,) returned error status, status = %d\n",status);
     }
 
+    pthread_condattr_destroy( &cond_attr );
+
     _prvData = static_cast<void *>(pd);
 
 }
@@ -153,31 +172,42 @@ int Condition::wait(Mutex *mutex) {
 //
 int Condition::wait(Mutex *mutex, unsigned long int ms) {
 
+    return waitFor(mutex, static_cast<uint64_t>(ms) * 1000000u);
+
+}
+
+//----------------------------------------------------------------------------
+//
+// Decription: wait on a condition, until an absolute deadline
+//
+// Use: public.
+//
+int Condition::waitUntil(Mutex *mutex, uint64_t deadlineNs) {
+
     PThreadConditionPrivateData *pd =
         static_cast<PThreadConditionPrivateData *>(_prvData);
 
     PThreadMutexPrivateData *mpd =
         static_cast<PThreadMutexPrivateData *>(mutex->_prvData);
 
+#ifdef OT_CONDITION_MONOTONIC_CLOCK
+    uint64_t abs_ns = deadlineNs;
+#else
+    // the condition runs on the system clock, so translate the remaining
+    // time to it.
+    uint64_t now_ns = getMonotonicTime();
+    uint64_t remaining_ns = deadlineNs > now_ns ? deadlineNs - now_ns : 0;
 
-    // wait time is now in ms milliseconds, so need to convert to seconds and nanoseconds for timespec strucuture.
-    unsigned int sec = ms / 1000;
-    unsigned int nsec = (ms % 1000) * 1000000;
-
-    // add to the current time    
     struct ::timeval now;
     ::gettimeofday( &now, 0 );
 
-    sec += now.tv_sec;
-    nsec += now.tv_usec*1000;
-
-    // now pass on any overflow from nsec onto seconds.
-    sec += nsec / 1000000000;
-    nsec = nsec % 1000000000;
+    uint64_t abs_ns = static_cast<uint64_t>(now.tv_sec) * 1000000000u + static_cast<uint64_t>(now.tv_usec) * 1000u;
+    abs_ns = remaining_ns < ~abs_ns ? abs_ns + remaining_ns : ~static_cast<uint64_t>(0);
+#endif
 
     struct timespec abstime;
-    abstime.tv_sec = sec;
-    abstime.tv_nsec = nsec;
+    abstime.tv_sec = static_cast<time_t>(abs_ns / 1000000000u);
+    abstime.tv_nsec = static_cast<long>(abs_ns % 1000000000u);
 
     int status;
 
@@ -191,6 +221,21 @@ int Condition::wait(Mutex *mutex, unsigned long int ms) {
 
 }
 
+//----------------------------------------------------------------------------
+//
+// Decription: wait on a condition, for a specified period of time
+//
+// Use: public.
+//
+int Condition::waitFor(Mutex *mutex, uint64_t ns) {
+
+    uint64_t now = getMonotonicTime();
+
+    // saturate, a huge timeout must not wrap around into the past
+    return waitUntil(mutex, ns < ~now ? now + ns : ~static_cast<uint64_t>(0));
+
+}
+
 //----------------------------------------------------------------------------
 //
 // Decription: signal a thread to wake up.
@@ -219,137 +264,160 @@ int Condition::broadcast() {
     return pthread_cond_broadcast( &pd->condition );
 }
 
+//----------------------------------------------------------------------------
+//
+// Decription: current time of the clock used by timed waits
+//
+// Use: public.
+//
+uint64_t Condition::getMonotonicTime() {
+
+#if defined(CLOCK_MONOTONIC) && !defined(_MSC_VER) && !defined(__MINGW32__)
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000u + static_cast<uint64_t>(now.tv_nsec);
+#else
+    struct ::timeval now;
+    ::gettimeofday( &now, 0 );
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000u + static_cast<uint64_t>(now.tv_usec) * 1000u;
+#endif
+
+}
+
 
 //---------------------------------------------------------
 // ConditionEx Pthreads implementation begins here
 //---------------------------------------------------------
 
 
-void event_init(Condition::Handle* evt, bool manual_reset, bool initial_state)
+//
+// The whole event lives in one futex word: the number of waiting threads
+// in the upper 16 bits and the number of pending wake-ups in the lower 16.
+// A manual-reset event only ever has 0 or 1 pending wake-up, its signaled
+// flag.  An auto-reset event hands out one wake-up per waiter, plus one
+// more that stands for the signaled state when nobody is left to release.
+// Signal() on an event nobody waits for is a single compare-and-swap.
+//
+static const int32_t EVENT_WAITER = 1 << 16;
+static const int32_t EVENT_WAKEUP_MASK = EVENT_WAITER - 1;
+
+static inline int32_t event_waiters(int32_t state) { return state >> 16; }
+static inline int32_t event_wakeups(int32_t state) { return state & EVENT_WAKEUP_MASK; }
+
+void event_init(ConditionEx::Handle* evt, bool manual_reset, bool initial_state)
 {
     evt->manual_reset = manual_reset;
-    evt->is_signaled = initial_state;
-    evt->waiting_threads = 0;
+    evt->state = initial_state ? 1 : 0;
+}
 
-    pthread_cond_init (&evt->condition, NULL);
-    pthread_mutex_init (&evt->lock, NULL);
+void event_destroy(ConditionEx::Handle* /*evt*/)
+{
 }
 
-void event_destroy(ConditionEx::Handle* evt)
+// Take a wake-up if one is pending, also unregistering as a waiter when
+// 'waiter' is set.  A manual-reset event keeps its wake-up.
+static inline bool event_try_consume(ConditionEx::Handle* evt, bool waiter)
 {
-    pthread_mutex_destroy (&evt->lock);
-    pthread_cond_destroy (&evt->condition);
+    for (;;)
+    {
+        int32_t state = evt->state;
+        if (event_wakeups(state) == 0)
+            return false;
+
+        int32_t next = state;
+        if (!evt->manual_reset) next -= 1;
+        if (waiter) next -= EVENT_WAITER;
+
+        if (next == state || AtomicCompareExchange(evt->state, next, state) == state)
+            return true;
+    }
 }
 
-bool event_wait(ConditionEx::Handle* evt, const timespec* timeout)
+bool event_wait(ConditionEx::Handle* evt, bool timed, uint64_t timeoutNs)
 {
-    bool result = true;
+    if (event_try_consume(evt, false))
+        return true;
 
-    // grab the lock first
-    pthread_mutex_lock (&evt->lock);
+    uint64_t deadline = timed ? Condition::getMonotonicTime() + timeoutNs : 0;
 
-    // Condition is currently signaled
-    if (evt->is_signaled)
+    AtomicAdd(evt->state, EVENT_WAITER);
+
+    for (;;)
     {
-        if (!evt->manual_reset)
+        int32_t state = evt->state;
+        if (event_wakeups(state) != 0)
         {
-            // AUTO: reset state
-            evt->is_signaled = 0;
+            if (event_try_consume(evt, true))
+                return true;
+            continue;
         }
-    }
-    else // evt is currently not signaled
-    {
-        evt->waiting_threads++;
 
-        if ( timeout )
+        if (timed)
         {
-            if ( pthread_cond_timedwait (&evt->condition, &evt->lock, timeout) == ETIMEDOUT )
-            {
-                result = false;
-            }
+            uint64_t now = Condition::getMonotonicTime();
+            if (now >= deadline)
+                break;
+            FutexWait(evt->state, state, deadline - now);
         }
         else
         {
-            pthread_cond_wait (&evt->condition, &evt->lock);
+            FutexWait(evt->state, state);
         }
-
-        evt->waiting_threads--;
     }
 
-    // Now we can let go of the lock
-    pthread_mutex_unlock (&evt->lock);
+    // Timed out.  A Signal() may have counted on us in the meantime, pass
+    // its wake-up on to the next waiter rather than lose it.
+    int32_t state = AtomicSubtract(evt->state, EVENT_WAITER) - EVENT_WAITER;
+    if (!evt->manual_reset && event_wakeups(state) != 0 && event_waiters(state) != 0)
+        FutexWake(evt->state, 1);
 
-    return result;
+    return false;
 }
 
 void event_signal(ConditionEx::Handle* evt)
 {
-    // grab the lock first
-    pthread_mutex_lock (&evt->lock);
-
-    // Manual-reset evt
-    if (evt->manual_reset)
+    for (;;)
     {
-        // signal evt
-        evt->is_signaled = true;
+        int32_t state = evt->state;
+        int32_t wakeups = event_wakeups(state);
+        int32_t waiters = event_waiters(state);
 
-        // wakeup all
-        pthread_cond_broadcast (&evt->condition);
-    }
-    // Auto-reset evt
-    else
-    {
-        if (evt->waiting_threads == 0)
-        {
-            // No waiters: signal evt
-            evt->is_signaled = true;
-        }
-        else
+        // Manual-reset: already signaled.  Auto-reset: every waiter has
+        // its wake-up and the event is signaled on top of that.
+        if (evt->manual_reset ? wakeups != 0 : wakeups > waiters)
+            return;
+
+        if (AtomicCompareExchange(evt->state, state + 1, state) == state)
         {
-            // Waiters: wakeup one waiter
-            pthread_cond_signal (&evt->condition);
+            if (evt->manual_reset)
+            {
+                // wakeup all
+                if (waiters != 0) FutexWakeAll(evt->state);
+            }
+            else if (wakeups < waiters)
+            {
+                // wakeup one waiter
+                FutexWake(evt->state, 1);
+            }
+            return;
         }
     }
-
-    // Now we can let go of the lock
-    pthread_mutex_unlock (&evt->lock);
 }
 
-void event_pulse(ConditionEx::Handle* evt)
+void event_reset(ConditionEx::Handle* evt)
 {
-    // grab the lock first
-    pthread_mutex_lock (&evt->lock);
-
-    // Manual-reset evt
-    if (evt->manual_reset)
+    // Drop the signaled state, but not the wake-ups already promised to
+    // waiters of an auto-reset event.
+    for (;;)
     {
-        // Wakeup all waiters
-        pthread_cond_broadcast (&evt->condition);
-    }
-
-    // Auto-reset evt: wakeup one waiter
-    else
-    {
-        pthread_cond_signal (&evt->condition);
+        int32_t state = evt->state;
+        int32_t keep = evt->manual_reset ? 0 : event_waiters(state);
+        if (event_wakeups(state) <= keep)
+            return;
 
-        // Reset evt
-        evt->is_signaled = false;
+        if (AtomicCompareExchange(evt->state, (state & ~EVENT_WAKEUP_MASK) | keep, state) == state)
+            return;
     }
-
-    // Now we can let go of the lock
-    pthread_mutex_unlock (&evt->lock);
-}
-
-void event_reset(ConditionEx::Handle* evt)
-{
-    // Grab the lock first
-    pthread_mutex_lock (&evt->lock);
-
-    // Reset evt
-    evt->is_signaled = false;
-
-    // Now we can let go of the lock
-    pthread_mutex_unlock (&evt->lock);
 }
 
 /// Constructor.
@@ -379,13 +447,10 @@ void ConditionEx::Reset()
 
 bool ConditionEx::Wait()
 {
-    return event_wait(&m_Handle, NULL);
+    return event_wait(&m_Handle, false, 0);
 }
 
-bool ConditionEx::Wait( uint32_t timeoutMs )
+bool ConditionEx::Wait( unsigned int timeoutMs )
 {
-    struct timespec spec;
-    spec.tv_sec = timeoutMs / 1000;
-    spec.tv_nsec = ( timeoutMs % 1000 ) * 1000000;
-    return event_wait(&m_Handle, &spec);
+    return event_wait(&m_Handle, true, static_cast<uint64_t>(timeoutMs) * 1000000u);
 }
@@ -30,7 +30,8 @@ using namespace OpenThreads;
 //
 // Use: public.
 //
-Barrier::Barrier(int numThreads)
+Barrier::Barrier(int numThreads, BarrierType /*type*/) :
+    _barrierType(BARRIER_BLOCKING)
 {
     QtBarrierPrivateData* pd = new QtBarrierPrivateData;
     pd->cnt = 0;
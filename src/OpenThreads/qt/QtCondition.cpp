@@ -18,6 +18,8 @@
 #include "QtMutexPrivateData.h"
 #include "QtConditionPrivateData.h"
 #include <iostream>
+#include <errno.h>
+#include <QElapsedTimer>
 
 using namespace OpenThreads;
 
@@ -72,6 +74,32 @@ int Condition::wait(Mutex *mutex, unsigned long int ms)
     return pd->wait(mpd, ms) ? 0 : 1;
 }
 
+//----------------------------------------------------------------------------
+//
+// Decription: wait on a condition, until an absolute deadline
+//
+// Use: public.
+//
+int Condition::waitUntil(Mutex *mutex, uint64_t deadlineNs)
+{
+    uint64_t now = getMonotonicTime();
+    return waitFor(mutex, deadlineNs > now ? deadlineNs - now : 0);
+}
+
+//----------------------------------------------------------------------------
+//
+// Decription: wait on a condition, for a specified period of time
+//
+// Use: public.
+//
+int Condition::waitFor(Mutex *mutex, uint64_t ns)
+{
+    QtMutexPrivateData* mpd = static_cast<QtMutexPrivateData*>(mutex->_prvData);
+    QtConditionPrivateData* pd = static_cast<QtConditionPrivateData*>(_prvData);
+    unsigned long ms = static_cast<unsigned long>((ns + 999999u) / 1000000u);
+    return pd->wait(mpd, ms) ? 0 : ETIMEDOUT;
+}
+
 //----------------------------------------------------------------------------
 //
 // Decription: signal a thread to wake up.
@@ -97,3 +125,22 @@ int Condition::broadcast()
     pd->wakeAll();
     return 0;
 }
+
+//----------------------------------------------------------------------------
+//
+// Decription: current time of the clock used by timed waits
+//
+// Use: public.
+//
+static QElapsedTimer startedTimer()
+{
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+}
+
+uint64_t Condition::getMonotonicTime()
+{
+    static QElapsedTimer s_timer = startedTimer();
+    return static_cast<uint64_t>(s_timer.nsecsElapsed());
+}
@@ -59,7 +59,8 @@ void barrier_cleanup_handler(void *arg) {
 //
 // Use: public.
 //
-Barrier::Barrier(int numThreads) {
+Barrier::Barrier(int numThreads, BarrierType /*type*/) :
+    _barrierType(BARRIER_BLOCKING) {
 
     SprocBarrierPrivateData *pd = new SprocBarrierPrivateData();
 
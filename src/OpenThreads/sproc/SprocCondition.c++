@@ -23,6 +23,7 @@
 #include "SprocThreadPrivateActions.h"
 #include <errno.h>
 #include <signal.h>
+#include <sys/time.h>
 
 using namespace OpenThreads;
 
@@ -244,6 +245,34 @@ int Condition::wait(Mutex *mutex, unsigned long int ms) {
     return 0;
 }
 
+//----------------------------------------------------------------------------
+//
+// Decription: wait on a condition, until an absolute deadline
+//
+// Use: public.
+//
+int Condition::waitUntil(Mutex *mutex, uint64_t deadlineNs) {
+
+    uint64_t now = getMonotonicTime();
+
+    return waitFor(mutex, deadlineNs > now ? deadlineNs - now : 0);
+}
+
+//----------------------------------------------------------------------------
+//
+// Decription: wait on a condition, for a specified period of time
+//
+// Use: public.
+//
+int Condition::waitFor(Mutex *mutex, uint64_t ns) {
+
+    // wait() treats 0 as "forever", so never round down to it
+    uint64_t ms = (ns + 999999u) / 1000000u;
+    if (ms == 0) ms = 1;
+
+    return wait(mutex, static_cast<unsigned long int>(ms));
+}
+
 //----------------------------------------------------------------------------
 //
 // Decription: signal a thread to wake up.
@@ -303,4 +332,16 @@ int Condition::broadcast() {
     return 0;
 }
 
+//----------------------------------------------------------------------------
+//
+// Decription: current time of the clock used by timed waits
+//
+// Use: public.
+//
+uint64_t Condition::getMonotonicTime() {
+
+    struct timeval now;
+    gettimeofday(&now, 0);
 
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000u + static_cast<uint64_t>(now.tv_usec) * 1000u;
+}
@@ -20,6 +20,7 @@
 #include "Win32ConditionPrivateData.h"
 
 #include <assert.h>
+#include <errno.h>
 
 using namespace OpenThreads;
 Win32ConditionPrivateData::~Win32ConditionPrivateData()
@@ -78,6 +79,37 @@ int Condition::wait(Mutex *mutex, unsigned long ms) {
 }
 //----------------------------------------------------------------------------
 //
+// Description: wait on a condition, until an absolute deadline
+//
+// Use: public.
+//
+int Condition::waitUntil(Mutex *mutex, uint64_t deadlineNs) {
+
+    uint64_t now = getMonotonicTime();
+
+    return waitFor(mutex, deadlineNs > now ? deadlineNs - now : 0);
+}
+//----------------------------------------------------------------------------
+//
+// Description: wait on a condition, for a specified period of time
+//
+// Use: public.
+//
+int Condition::waitFor(Mutex *mutex, uint64_t ns) {
+
+    Win32ConditionPrivateData *pd =
+        static_cast<Win32ConditionPrivateData *>(_prvData);
+
+    // the wait functions count in milliseconds, round up so that a short
+    // timeout doesn't turn into a poll.
+    uint64_t ms = (ns + 999999u) / 1000000u;
+    if (ms >= INFINITE) ms = INFINITE - 1;
+
+    int result = pd->wait(*mutex, static_cast<long>(ms));
+    return result == WAIT_TIMEOUT ? ETIMEDOUT : result;
+}
+//----------------------------------------------------------------------------
+//
 // Description: signal a thread to wake up.
 //
 // Use: public.
@@ -100,6 +132,25 @@ int Condition::broadcast() {
         static_cast<Win32ConditionPrivateData *>(_prvData);
     return pd->broadcast();
 }
+//----------------------------------------------------------------------------
+//
+// Description: current time of the clock used by timed waits
+//
+// Use: public.
+//
+uint64_t Condition::getMonotonicTime() {
+
+    static LARGE_INTEGER s_frequency = { 0 };
+    if (s_frequency.QuadPart == 0) QueryPerformanceFrequency(&s_frequency);
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+
+    // split the conversion to avoid overflowing 64 bits
+    uint64_t ticks = static_cast<uint64_t>(counter.QuadPart);
+    uint64_t frequency = static_cast<uint64_t>(s_frequency.QuadPart);
+    return (ticks / frequency) * 1000000000u + ((ticks % frequency) * 1000000000u) / frequency;
+}
 
 //---------------------------------------------------------
 // ConditionEx Win32 implementation begins here
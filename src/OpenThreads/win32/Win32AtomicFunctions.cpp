@@ -3,6 +3,9 @@
 #define VC_EXTRALEAN
 #include <windows.h>
 
+// inline in the header when building with the __atomic builtins (MinGW)
+#if !defined(_OPENTHREADS_ATOMIC_USE_GCC_ATOMIC_BUILTINS)
+
 #define _GENERATE_ATOMIC_WORKER( PREFIX, OPERATION, PARAM_LIST, ACTION ) \
     PREFIX OpenThreads::Atomic##OPERATION PARAM_LIST ACTION \
     PREFIX OpenThreads::Atomic##OPERATION##Acquire PARAM_LIST ACTION \
@@ -280,4 +283,82 @@ _GENERATE_ATOMIC_WORKER(
 
 #endif
 
-#undef _GENERATE_ATOMIC_WORKER
\ No newline at end of file
+#undef _GENERATE_ATOMIC_WORKER
+
+void OpenThreads::AtomicThreadFence()
+{
+    MemoryBarrier();
+}
+
+void OpenThreads::AtomicThreadFenceAcquire()
+{
+    MemoryBarrier();
+}
+
+void OpenThreads::AtomicThreadFenceRelease()
+{
+    MemoryBarrier();
+}
+
+#endif
+
+//--- 128-bit, needed with either set of intrinsics
+
+#if defined( _M_X64 ) || defined( __x86_64__ )
+
+OpenThreads::AtomicInt128 OpenThreads::AtomicCompareExchange128( AtomicInt128 volatile & rAtomic, AtomicInt128 value, AtomicInt128 compare )
+{
+    __int64 comparand[2] = { compare.low, compare.high };
+    _InterlockedCompareExchange128(
+        reinterpret_cast< volatile __int64* >( &rAtomic ),
+        value.high,
+        value.low,
+        comparand );
+
+    // comparand now holds the original value, whether or not it matched
+    AtomicInt128 result = { comparand[0], comparand[1] };
+    return result;
+}
+
+bool OpenThreads::AtomicCompareExchange128IsLockFree()
+{
+    return true;
+}
+
+#else
+
+namespace {
+
+// Striped locks, so that unrelated variables rarely contend.
+const unsigned int NUM_ATOMIC128_LOCKS = 64;
+volatile LONG s_atomic128Locks[NUM_ATOMIC128_LOCKS];
+
+}
+
+OpenThreads::AtomicInt128 OpenThreads::AtomicCompareExchange128( AtomicInt128 volatile & rAtomic, AtomicInt128 value, AtomicInt128 compare )
+{
+    volatile LONG& lock = s_atomic128Locks[ ( reinterpret_cast< uintptr_t >( &rAtomic ) / sizeof(AtomicInt128) ) % NUM_ATOMIC128_LOCKS ];
+    while( _InterlockedExchange( &lock, 1 ) != 0 )
+    {
+        while( lock != 0 ) SpinPause();
+    }
+
+    AtomicInt128 original;
+    original.low = rAtomic.low;
+    original.high = rAtomic.high;
+    if( original == compare )
+    {
+        rAtomic.low = value.low;
+        rAtomic.high = value.high;
+    }
+
+    _InterlockedExchange( &lock, 0 );
+    return original;
+}
+
+bool OpenThreads::AtomicCompareExchange128IsLockFree()
+{
+    return false;
+}
+
+#endif
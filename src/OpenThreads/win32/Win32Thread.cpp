@@ -34,6 +34,7 @@ using std::size_t;
 #endif
 
 #include "Win32ThreadPrivateData.h"
+#include <OpenThreads/Arena.h>
 
 struct Win32ThreadCanceled{};
 
@@ -124,6 +125,8 @@ namespace OpenThreads {
                 // abnormal termination but must be caught in win32 anyway
             }
 
+            ThreadLocalArena::release();
+
             TlsSetValue(Win32ThreadPrivateData::TLS.getId(), 0);
             pd->isRunning = false;
 
@@ -33,7 +33,8 @@ Win32BarrierPrivateData::~Win32BarrierPrivateData()
 //
 // Use: public.
 //
-Barrier::Barrier(int numThreads) {
+Barrier::Barrier(int numThreads, BarrierType /*type*/) :
+    _barrierType(BARRIER_BLOCKING) {
     Win32BarrierPrivateData *pd = new Win32BarrierPrivateData(numThreads, 0, 0);
     _valid = true;
     _prvData = static_cast<void *>(pd);